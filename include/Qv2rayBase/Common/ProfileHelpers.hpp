@@ -50,6 +50,10 @@ namespace Qv2rayBase::Utils
     QV2RAYBASE_EXPORT QMap<QString, IOBoundData> GetOutboundInfo(const ProfileContent &out);
     QV2RAYBASE_EXPORT QMap<QString, IOBoundData> GetOutboundInfo(const ConnectionId &id);
 
+    ///
+    /// \brief ExpandProfileChains Replaces chain outbounds with chained outbounds and local inbounds.
+    /// Ports of the new inbounds are free when the profile is expanded, nothing is reserved until it's started.
+    ///
     QV2RAYBASE_EXPORT bool ExpandProfileChains(ProfileContent &root);
     QV2RAYBASE_EXPORT QList<OutboundObject> ExpandProfileExternalOutbounds(const QList<OutboundObject> &outbounds);
 } // namespace Qv2rayBase::Utils
@@ -47,8 +47,67 @@ namespace Qv2rayBase::Models
     struct PluginConfigObject
     {
         int plugin_port_allocation = 15490;
+        // In milliseconds, statistics events are coalesced and delivered to plugins at most once per interval.
+        int stats_event_interval = 1000;
+        // Number of synchronous latency tests running at the same time.
+        int latency_test_parallelism = 8;
+        // Number of connections made to each server by the built-in TCP latency test, and the timeout of each one in milliseconds.
+        int latency_test_samples = 3;
+        int latency_test_timeout = 5000;
         QMap<QString, bool> plugin_states;
-        QJS_JSON(F(plugin_port_allocation, plugin_states))
+        QJS_JSON(F(plugin_port_allocation, stats_event_interval, latency_test_parallelism, latency_test_samples, latency_test_timeout, plugin_states))
+    };
+
+    struct KernelConfigObject
+    {
+        // Prepare the new kernels while the old ones are still running when switching connections.
+        bool seamless_switching = false;
+        // Write kernel logs into rotated files, under the "logs" directory of the storage location.
+        bool log_file_enabled = false;
+        // In MiB.
+        int log_file_max_size = 8;
+        // In hours, 0 to rotate by size only.
+        int log_file_max_age = 24;
+        int log_file_keep_count = 5;
+        // Rotated segments are compressed into gzip files, when the library is built with zlib.
+        bool log_file_compress = false;
+        // Count V2Ray/Xray access log lines by destination and outbound.
+        bool access_log_statistics = false;
+        // Restart crashed kernels with exponential backoff, until they crash too often.
+        bool auto_restart = false;
+        // Give up restarting after this many crashes within auto_restart_crash_window seconds.
+        int auto_restart_max_crashes = 5;
+        int auto_restart_crash_window = 60;
+        // In seconds, how often the kernel processes are sampled, 0 to disable.
+        int resource_monitor_interval = 0;
+        // Thresholds of resource alerts, in MiB and percent of one CPU core. 0 to disable.
+        int resource_alert_rss = 0;
+        int resource_alert_cpu = 0;
+        // In seconds, how long to wait for the inbounds to accept connections before reporting the connection, 0 to report it right away.
+        // Only TCP inbounds listening on an IP address are waited for.
+        int readiness_timeout = 10;
+        // Prepare the kernels of the likely next connection in the background, once a connection is established.
+        bool prefetch_next_connection = false;
+        // Poll the V2Ray StatsService API of the current connection on this local port, 0 to use the statistics reported by the kernels.
+        int stats_api_port = 0;
+        // In milliseconds.
+        int stats_api_interval = 1000;
+        QJS_JSON(F(seamless_switching, log_file_enabled, log_file_max_size, log_file_max_age, log_file_keep_count, log_file_compress, access_log_statistics, //
+                   auto_restart, auto_restart_max_crashes, auto_restart_crash_window,                                                                        //
+                   resource_monitor_interval, resource_alert_rss, resource_alert_cpu, readiness_timeout, prefetch_next_connection,                           //
+                   stats_api_port, stats_api_interval))
+    };
+
+    struct FailoverConfigObject
+    {
+        bool enabled = false;
+        // In seconds, a dead server is detected and replaced within this window.
+        int detection_window = 30;
+        // Number of consecutive failed probes before switching to another connection.
+        int failed_probes = 3;
+        // Empty to use the first available latency test engine.
+        QString latency_test_engine;
+        QJS_JSON(F(enabled, detection_window, failed_probes, latency_test_engine))
     };
 
     struct Qv2rayBaseConfigObject
@@ -56,7 +115,9 @@ namespace Qv2rayBase::Models
         int config_version = QV2RAY_SETTINGS_VERSION;
         NetworkProxyConfig network_config;
         PluginConfigObject plugin_config;
+        KernelConfigObject kernel_config;
+        FailoverConfigObject failover_config;
         QJsonObject extra_options;
-        QJS_JSON(F(config_version, network_config, plugin_config, extra_options))
+        QJS_JSON(F(config_version, network_config, plugin_config, kernel_config, failover_config, extra_options))
     };
 } // namespace Qv2rayBase::Models
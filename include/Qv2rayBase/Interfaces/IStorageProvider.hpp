@@ -56,6 +56,15 @@ namespace Qv2rayBase::Interfaces
         virtual bool StoreConnection(const ConnectionId &, const ProfileContent &) = 0;
         virtual bool DeleteConnection(const ConnectionId &) = 0;
 
+        // Batched version of StoreConnection, providers with transactions may override this to commit once.
+        virtual bool StoreConnectionContents(const QHash<ConnectionId, ProfileContent> &contents)
+        {
+            bool result = true;
+            for (auto it = contents.constKeyValueBegin(); it != contents.constKeyValueEnd(); it++)
+                result &= StoreConnection(it->first, it->second);
+            return result;
+        }
+
         virtual QDir GetPluginWorkingDirectory(const PluginId &) = 0;
         virtual QDir GetUserPluginDirectory() = 0;
         virtual QJsonObject GetPluginSettings(const PluginId &) = 0;
@@ -21,6 +21,11 @@
 
 namespace Qv2rayBase::Plugin
 {
+    ///
+    /// \brief The built-in latency test engine measuring TCP connection time, only available when built with libuv.
+    ///
+    const inline LatencyTestEngineId BuiltinTcpLatencyTestEngineId{ QStringLiteral("qv2raybase_tcp_connect") };
+
     class LatencyTestHostPrivate;
     class QV2RAYBASE_EXPORT LatencyTestHost : public QObject
     {
@@ -51,6 +51,12 @@ namespace Qv2rayBase::Plugin
             SendEventInternal(object);
         }
 
+        ///
+        /// \brief Event_SendPendingStats Delivers statistics events held back from slow plugins.
+        /// \return Whether some events are still pending, this should be called again later then.
+        ///
+        bool Event_SendPendingStats() const;
+
         // Outbound Get/Set Data
         std::optional<PluginIOBoundData> Outbound_GetData(const IOConnectionSettings &) const;
         bool Outbound_SetData(IOConnectionSettings &, const PluginIOBoundData &) const;
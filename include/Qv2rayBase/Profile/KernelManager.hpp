@@ -19,9 +19,79 @@
 #include "Qv2rayBase/Plugin/PluginAPIHost.hpp"
 #include "Qv2rayBase/Qv2rayBaseLibrary.hpp"
 
+#include <array>
+
 namespace Qv2rayBase::Profile
 {
+    ///
+    /// \brief Time spent to prepare and start a kernel of the current connection, in milliseconds.
+    ///
+    struct KernelTiming
+    {
+        QString name;
+        qint64 prepare = 0;
+        qint64 start = 0;
+    };
+
+    ///
+    /// \brief Access log counters, with the busiest destination domains and outbounds in descending order.
+    ///
+    struct AccessLogStatistics
+    {
+        quint64 accepted = 0;
+        quint64 rejected = 0;
+        QList<std::pair<QString, quint64>> destinations;
+        QList<std::pair<QString, quint64>> outbounds;
+    };
+
+    ///
+    /// \brief Crash and restart counters of the kernel supervisor.
+    ///
+    struct KernelSupervisorStatistics
+    {
+        quint64 crashes = 0;
+        quint64 restarts = 0;
+        // Number of crashed sessions by uptime: < 10s, < 1min, < 10min, < 1h and longer.
+        std::array<quint64, 5> uptimeHistogram{};
+    };
+
+    ///
+    /// \brief Resource usage of a kernel process, sampled periodically.
+    ///
+    struct KernelResourceUsage
+    {
+        QString name;
+        qint64 pid = 0;
+        // In bytes.
+        qint64 rss = 0;
+        // Percentage of one CPU core.
+        double cpu = 0;
+        int threads = 0;
+        quint64 readBytes = 0;
+        quint64 writeBytes = 0;
+    };
+
+    ///
+    /// \brief Counters polled from the V2Ray StatsService API, traffic is in bytes.
+    ///
+    struct KernelTrafficStatistics
+    {
+        // Tag -> { uplink, downlink }
+        QMap<QString, std::pair<quint64, quint64>> inbounds;
+        QMap<QString, std::pair<quint64, quint64>> outbounds;
+        quint32 goroutines = 0;
+        quint64 memoryAlloc = 0;
+        quint64 memorySys = 0;
+        quint32 numGC = 0;
+        // In seconds.
+        quint32 uptime = 0;
+        // Last error of the StatsService API, traffic is taken from the kernels until it answers again.
+        QString error;
+    };
+
     class KernelManagerPrivate;
+    struct KernelSession;
+    struct KernelCrashState;
     class QV2RAYBASE_EXPORT KernelManager : public QObject
     {
         Q_OBJECT
@@ -29,24 +99,89 @@ namespace Qv2rayBase::Profile
         explicit KernelManager(QObject *parent = nullptr);
         ~KernelManager();
 
+        ///
+        /// \brief StartConnection Start a profile, replacing all running profiles.
+        ///
         std::optional<QString> StartConnection(const ProfileId &id, const ProfileContent &root);
+        ///
+        /// \brief StartAdditionalConnection Start a profile alongside the running ones, or restart it if it's already running.
+        ///
+        std::optional<QString> StartAdditionalConnection(const ProfileId &id, const ProfileContent &root);
         void StopConnection();
+        void StopConnection(const ProfileId &id);
+        ///
+        /// \brief PrefetchConnection Prepare the kernels of a profile in the background, starting the same profile later only starts them.
+        ///
+        void PrefetchConnection(const ProfileId &id, const ProfileContent &root);
+
+        ///
+        /// \brief ReloadConnection Apply a new profile to a running connection, kernels are only restarted when necessary.
+        ///
+        std::optional<QString> ReloadConnection(const ProfileId &id, const ProfileContent &root);
+        ///
+        /// \brief SupportsReload Whether the default kernel of a running connection can apply a new profile without restarting.
+        ///
+        bool SupportsReload(const ProfileId &id) const;
+
+        ///
+        /// \brief CurrentConnection The first running profile, null if there's nothing running.
+        ///
         const ProfileId CurrentConnection() const;
+        const QList<ProfileId> ActiveConnections() const;
+        bool IsConnected(const ProfileId &id) const;
         size_t ActiveKernelCount() const;
         const QMap<QString, IOBoundData> GetCurrentConnectionInboundInfo() const;
+        const QMap<QString, IOBoundData> GetConnectionInboundInfo(const ProfileId &id) const;
+        const QList<KernelTiming> GetKernelTimings(const ProfileId &id = {}) const;
+        ///
+        /// \brief GetConnectionReadyTime Milliseconds the inbounds took to accept connections after the kernels were started, -1 if unknown.
+        ///
+        qint64 GetConnectionReadyTime(const ProfileId &id = {}) const;
+        quint64 DroppedKernelLogLines() const;
+        AccessLogStatistics GetAccessLogStatistics(int topK = 10) const;
+        void ClearAccessLogStatistics();
+        KernelSupervisorStatistics GetSupervisorStatistics() const;
+        const QList<KernelResourceUsage> GetKernelResourceUsage() const;
+        ///
+        /// \brief GetKernelTrafficStatistics Counters of the current connection, only available when the StatsService API is polled.
+        ///
+        KernelTrafficStatistics GetKernelTrafficStatistics() const;
 
       signals:
         void OnConnected(const ProfileId &id);
+        ///
+        /// \brief OnDisconnected Only emitted for connections reported by OnConnected before.
+        ///
         void OnDisconnected(const ProfileId &id);
         void OnCrashed(const ProfileId &id, const QString &errMessage);
+        ///
+        /// \brief Kernel logs are delivered in batches, a batch may contain several lines separated by '\n'.
+        ///
         void OnKernelLogAvailable(const ProfileId &id, const QString &log);
         void OnStatsDataAvailable(const ProfileId &id, StatisticsObject);
+        void OnKernelResourceAlert(const ProfileId &id, const KernelResourceUsage &usage);
+
+      protected:
+        void timerEvent(QTimerEvent *event) override;
 
       private slots:
         void OnKernelStatsDataRcvd_p(const StatisticsObject &);
         void OnKernelCrashed_p(const QString &msg);
         void OnKernelLog_p(const QString &log);
 
+      private:
+        std::optional<QString> p_StartSession(const ProfileId &id, const ProfileContent &root, const ProfileId &replaced, qsizetype position = -1);
+        bool p_StopSession(const ProfileId &id);
+        void p_CancelRestarts(const ProfileId &id);
+        void p_FlushKernelLogs();
+        bool p_ScheduleRestart(const ProfileId &id, const ProfileContent &profile, qsizetype position, KernelCrashState crashState, const QString &reason);
+        void p_SampleKernelResources();
+        void p_UpdateStatsPoller();
+        void p_DiscardPrefetched();
+        void p_WaitUntilReady(const KernelSession &session);
+        void p_OnSessionReady(const ProfileId &id, quint64 serial, std::optional<qint64> readyTime);
+        void p_OnServiceStatsReceived(const QList<std::pair<QString, qint64>> &stats);
+
       private:
         QScopedPointer<KernelManagerPrivate> d_ptr;
         Q_DECLARE_PRIVATE(KernelManager)
@@ -19,8 +19,30 @@
 #include "Qv2rayBase/Qv2rayBaseFeatures.hpp"
 #include "QvPlugin/PluginInterface.hpp"
 
+#include <functional>
+
 namespace Qv2rayBase::Profile
 {
+    ///
+    /// \brief Distribution of the recent latency test results of a connection, in milliseconds.
+    /// Percentiles are -1 when there's no successful sample.
+    ///
+    struct LatencyStatistics
+    {
+        int samples = 0;
+        int failed = 0;
+        int p50 = -1;
+        int p95 = -1;
+        int jitter = 0;
+    };
+
+    enum class TrafficHistoryResolution
+    {
+        PerSecond,
+        PerMinute,
+        PerHour,
+    };
+
     class ProfileManagerPrivate;
     class QV2RAYBASE_EXPORT ProfileManager
         : public QObject
@@ -48,6 +70,19 @@ namespace Qv2rayBase::Profile
         void UpdateConnection(const ConnectionId &id, const ProfileContent &root) override;
         void RenameConnection(const ConnectionId &id, const QString &newName) override;
 
+        ///
+        /// \brief QueryConnections Search connections with a query, e.g. "tag:hk protocol:vmess latency<200"
+        /// All terms must match, see ConnectionIndex for the supported terms.
+        ///
+        const QList<ConnectionId> QueryConnections(const QString &query) const;
+
+        ///
+        /// \brief ImportLinks Decode share links in parallel and create connections in one batch.
+        /// Links pointing to an endpoint which already exists in the group (or earlier in the list) are skipped.
+        /// \return The created profiles, and the error message of every link which was not imported, keyed by its index in links.
+        ///
+        std::pair<QList<ProfileId>, QMap<int, QString>> ImportLinks(const QStringList &links, const GroupId &groupId = DefaultGroupId);
+
         // Group Related
         const QList<GroupId> GetGroups() const override;
         const QList<GroupId> GetGroups(const ConnectionId &connId) const override;
@@ -82,10 +117,13 @@ namespace Qv2rayBase::Profile
         // Statistics Related
         void ClearGroupUsage(const GroupId &id);
         void ClearConnectionUsage(const ProfileId &id);
+        QList<StatisticsObject> GetTrafficHistory(const ConnectionId &id, TrafficHistoryResolution resolution) const;
+        StatisticsObject GetTrafficRate(const ConnectionId &id) const;
 
         // Latency Testing Related
         void StartLatencyTest(const ConnectionId &id, const LatencyTestEngineId &engine);
         void StartLatencyTest(const GroupId &id, const LatencyTestEngineId &engine);
+        LatencyStatistics GetLatencyStatistics(const ConnectionId &id) const;
 
       signals:
         void OnLatencyTestStarted(const ConnectionId &id);
@@ -101,10 +139,24 @@ namespace Qv2rayBase::Profile
         void OnGroupRenamed(const GroupId &id, const QString &oldName, const QString &newName);
         void OnGroupDeleted(const GroupId &id, const QList<ConnectionId> &connections);
 
+      protected:
+        void timerEvent(QTimerEvent *event) override;
+
       private slots:
         bool p_UpdateSubscriptionImpl(const GroupId &id, bool isAsync);
         void p_OnLatencyDataArrived(const ConnectionId &id, const Qv2rayPlugin::LatencyTestResponse &data);
         void p_OnStatsDataArrived(const ProfileId &id, const StatisticsObject &speed);
+        void p_OnKernelConnected(const ProfileId &id);
+        void p_OnKernelDisconnected(const ProfileId &id);
+        void p_OnKernelCrashed(const ProfileId &id, const QString &errMessage);
+
+      private:
+        void p_Failover(const ProfileId &failedId);
+        ProfileContent p_GetEffectiveProfile(const ProfileId &identifier);
+        std::pair<ConnectionId, int> p_FindBestConnection(const GroupId &group, const ConnectionId &excluded);
+        void p_PrefetchNextConnection(const ProfileId &current);
+        void p_ReloadRunningConnections(const std::function<bool(const ProfileId &)> &predicate);
+        void p_SendPendingStatsEvents();
 
       private:
         QScopedPointer<ProfileManagerPrivate> d_ptr;
@@ -0,0 +1,54 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+
+#pragma once
+#include <QList>
+#include <QSet>
+
+namespace Qv2rayBase::_private
+{
+    ///
+    /// \brief Finds free TCP ports on the loopback address for kernels and chain inbounds.
+    /// Reserved ports are skipped by every later lookup until they are released.
+    ///
+    class PortAllocator
+    {
+      public:
+        ///
+        /// \brief Probe and return at most count free ports, starting from base.
+        /// The result is shorter than count when the port range runs out.
+        ///
+        static QList<int> FindAvailablePorts(int base, int count, const QSet<int> &excluded = {});
+        static QList<int> ReservePorts(int base, int count, const QSet<int> &excluded = {});
+        ///
+        /// \brief Reserve the given ports, those reserved by someone else already are left out of the result.
+        ///
+        static QSet<int> ClaimPorts(const QSet<int> &ports);
+        static void ReleasePorts(const QSet<int> &ports);
+
+      private:
+        static QList<int> ProbePorts(const QList<int> &candidates);
+    };
+} // namespace Qv2rayBase::_private
@@ -26,15 +26,20 @@
 #include "QvPlugin/Handlers/LatencyTestHandler.hpp"
 
 #include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 namespace uvw
 {
-    class TimerHandle;
+    class AsyncHandle;
 }
 
 namespace Qv2rayBase::Plugin
 {
     class LatencyTestHost;
+    class TcpLatencyTest;
     class LatencyTestThread : public QThread
     {
         Q_OBJECT
@@ -47,17 +52,23 @@ namespace Qv2rayBase::Plugin
         void run() override;
 
       private:
-#ifndef QV2RAYBASE_NO_LIBUV
-        void doTest(Qv2rayBase::Plugin::LatencyTestHost *parent, uvw::TimerHandle &handle);
-#else
         void doTest(Qv2rayBase::Plugin::LatencyTestHost *parent);
-#endif
 
       private:
         std::shared_ptr<uvw::Loop> loop;
-        bool isStop = false;
-        std::shared_ptr<uvw::TimerHandle> stopTimer;
+        std::atomic_bool isStop = false;
+        // Wakes the thread up when there are new requests or it should stop, guarded by m.
+#ifndef QV2RAYBASE_NO_LIBUV
+        std::shared_ptr<uvw::AsyncHandle> wakeup;
+        // Built-in tests running on the loop, only touched from the loop thread.
+        std::vector<std::weak_ptr<TcpLatencyTest>> tcpTests;
+#else
+        std::condition_variable wakeup;
+#endif
+        // Producers only append under the lock, the thread swaps the whole queue out and runs the tests without holding it.
         std::vector<Qv2rayPlugin::Latency::LatencyTestRequest> requests;
         std::mutex m;
+        // Synchronous engines block, they run here instead of on the event loop.
+        QThreadPool syncPool;
     };
 } // namespace Qv2rayBase::Plugin
@@ -33,5 +33,21 @@ namespace Qv2rayBase::Plugin
         ~PluginAPIHostPrivate() = default;
         QHash<LatencyTestEngineId, Qv2rayPlugin::LatencyTestEngineInfo> latencyTesters = {};
         QHash<KernelId, Qv2rayPlugin::KernelFactory> kernels = {};
+
+        // Built by InitializePlugins, kernels for each protocol are ranked by the number of protocols they support.
+        QHash<QString, QList<KernelId>> protocolKernels = {};
+        // Position of each kernel in that ranking, ties between kernels are broken by it.
+        QHash<KernelId, qsizetype> kernelRanks = {};
+        KernelId defaultKernel = NullKernelId;
+
+        struct StatsEventState
+        {
+            // Number of statistics events the plugin should skip after being too slow.
+            int penalty = 0;
+            int skipped = 0;
+            // The latest event of each connection which has not been delivered yet.
+            QHash<ConnectionId, Qv2rayPlugin::Event::ConnectionStats::EventObject> pending = {};
+        };
+        mutable QHash<const Qv2rayPlugin::Qv2rayInterfaceImpl *, StatsEventState> statsEventStates = {};
     };
 } // namespace Qv2rayBase::Plugin
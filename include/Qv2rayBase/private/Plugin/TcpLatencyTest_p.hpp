@@ -0,0 +1,79 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+
+#pragma once
+#include "QvPlugin/Handlers/LatencyTestHandler.hpp"
+
+#include <chrono>
+#include <functional>
+#include <optional>
+
+#ifndef QV2RAYBASE_NO_LIBUV
+#include <uvw.hpp>
+
+namespace Qv2rayBase::Plugin
+{
+    ///
+    /// \brief The built-in latency test, measuring how long TCP connections to the target take on a libuv loop.
+    /// Samples of one target are taken one after another, any number of targets can be tested concurrently.
+    ///
+    class TcpLatencyTest : public std::enable_shared_from_this<TcpLatencyTest>
+    {
+      public:
+        using Callback = std::function<void(const Qv2rayPlugin::Latency::LatencyTestResponse &)>;
+        static std::shared_ptr<TcpLatencyTest> Start(const std::shared_ptr<uvw::Loop> &loop, const Qv2rayPlugin::Latency::LatencyTestRequest &request, int samples,
+                                                     int timeout, Callback callback);
+        ///
+        /// \brief Closes the handles of the running sample, the callback is not called any more.
+        /// Must be called from the loop thread.
+        ///
+        void Cancel();
+
+      private:
+        TcpLatencyTest(const std::shared_ptr<uvw::Loop> &loop, const Qv2rayPlugin::Latency::LatencyTestRequest &request, int samples, int timeout, Callback callback);
+        void Resolve();
+        void NextSample();
+        void OnSample(std::optional<long> latency, const QString &error);
+        void Finish(const QString &error);
+
+      private:
+        const std::shared_ptr<uvw::Loop> loop;
+        const Qv2rayPlugin::Latency::LatencyTestRequest request;
+        const int samples;
+        const int timeout;
+        const Callback callback;
+
+        bool cancelled = false;
+        std::weak_ptr<uvw::GetAddrInfoReq> resolver;
+        std::weak_ptr<uvw::TCPHandle> currentConnection;
+        std::weak_ptr<uvw::TimerHandle> currentTimer;
+
+        sockaddr_storage address{};
+        int completed = 0;
+        std::vector<long> latencies;
+        QString lastError;
+    };
+} // namespace Qv2rayBase::Plugin
+#endif
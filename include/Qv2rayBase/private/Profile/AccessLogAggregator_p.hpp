@@ -0,0 +1,83 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringView>
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief One line of a V2Ray/Xray access log, views point into the original line.
+    ///
+    struct AccessLogEntry
+    {
+        bool accepted = false;
+        QStringView source;
+        QStringView destination;
+        QStringView inboundTag;
+        QStringView outboundTag;
+    };
+
+    ///
+    /// \brief Aggregates access log lines by destination domain and outbound tag.
+    ///
+    class AccessLogAggregator
+    {
+      public:
+        // Distinct destinations beyond this are counted as OtherDestinations.
+        constexpr static qsizetype MaxDestinations = 16384;
+        const static inline QString OtherDestinations = QStringLiteral("<other>");
+
+        ///
+        /// \brief Parse Parse an access log line, returns false for other log lines.
+        ///
+        static bool Parse(QStringView line, AccessLogEntry &entry);
+
+        void Add(QStringView line);
+        void Clear();
+
+        quint64 Accepted() const
+        {
+            return accepted;
+        }
+        quint64 Rejected() const
+        {
+            return rejected;
+        }
+
+        QList<std::pair<QString, quint64>> TopDestinations(int k) const;
+        QList<std::pair<QString, quint64>> TopOutbounds(int k) const;
+
+      private:
+        quint64 accepted = 0;
+        quint64 rejected = 0;
+        QHash<QString, quint64> destinations;
+        QHash<QString, quint64> outbounds;
+    };
+} // namespace Qv2rayBase::Profile
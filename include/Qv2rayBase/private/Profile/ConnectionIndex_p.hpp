@@ -0,0 +1,69 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+#pragma once
+
+#include "QvPlugin/PluginInterface.hpp"
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief An inverted index over connection names, tags, protocols, hosts and ports.
+    /// All keys are stored in lower case, a posting list is kept for every key so that
+    /// a query only touches the connections which can possibly match.
+    ///
+    class ConnectionIndex
+    {
+      public:
+        void Update(const ConnectionId &id, const ConnectionObject &object, const ProfileContent &content);
+        void Remove(const ConnectionId &id);
+        void Clear();
+
+        ///
+        /// \brief Query Evaluates a query, all terms are joined with AND.
+        /// Supported terms: "tag:x", "protocol:x", "host:x", "port:n", "name:x", "latency<n" (also <=, >, >=, =),
+        /// any other term is matched against tokens of the connection name.
+        ///
+        QList<ConnectionId> Query(const QString &query, const QHash<ConnectionId, ConnectionObject> &connections) const;
+
+        static QStringList Tokenize(const QString &str);
+
+      private:
+        struct IndexedEntry
+        {
+            QStringList nameTokens;
+            QStringList tags;
+            QString protocol;
+            QString host;
+            int port = 0;
+        };
+
+        QHash<ConnectionId, IndexedEntry> entries;
+        QHash<QString, QSet<ConnectionId>> nameIndex;
+        QHash<QString, QSet<ConnectionId>> tagIndex;
+        QHash<QString, QSet<ConnectionId>> protocolIndex;
+        QHash<QString, QSet<ConnectionId>> hostIndex;
+        QHash<int, QSet<ConnectionId>> portIndex;
+    };
+} // namespace Qv2rayBase::Profile
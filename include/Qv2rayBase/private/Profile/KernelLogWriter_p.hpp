@@ -0,0 +1,74 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+
+#pragma once
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief Writes kernel logs into a file on a dedicated thread, rotating it by size or age.
+    ///
+    class KernelLogWriter : public QThread
+    {
+        Q_OBJECT
+      public:
+        struct Options
+        {
+            QString directory;
+            qint64 maxSize;
+            // In milliseconds, 0 to rotate by size only.
+            qint64 maxAge;
+            int keepCount;
+            bool compress;
+        };
+
+        explicit KernelLogWriter(const Options &options, QObject *parent = nullptr);
+        ~KernelLogWriter();
+
+        void Append(const QString &lines);
+        void Stop();
+
+      protected:
+        void run() override;
+
+      private:
+        bool Open(QFile &file);
+        void Rotate(QFile &file);
+
+      private:
+        const Options options;
+        QMutex mutex;
+        QWaitCondition condition;
+        QList<std::pair<qint64, QString>> pending;
+        qsizetype pendingSize = 0;
+        quint64 dropped = 0;
+        bool stopping = false;
+    };
+} // namespace Qv2rayBase::Profile
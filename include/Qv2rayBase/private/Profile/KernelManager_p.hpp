@@ -23,18 +23,122 @@
 // ************************ WARNING ************************
 
 #pragma once
+#include "Qv2rayBase/Profile/KernelManager.hpp"
+#include "Qv2rayBase/private/Profile/AccessLogAggregator_p.hpp"
+#include "Qv2rayBase/private/Profile/KernelLogWriter_p.hpp"
+#include "Qv2rayBase/private/Profile/KernelReadinessProbe_p.hpp"
+#include "Qv2rayBase/private/Profile/ProcessSampler_p.hpp"
+#include "Qv2rayBase/private/Profile/StatsServiceClient_p.hpp"
 #include "QvPlugin/PluginInterface.hpp"
 
 namespace Qv2rayBase::Profile
 {
-    class KernelManagerPrivate
+    using KernelList = std::list<std::pair<QString, std::unique_ptr<Qv2rayPlugin::PluginKernel>>>;
+
+    ///
+    /// \brief A bounded FIFO of log lines, the oldest lines are dropped when it's full.
+    ///
+    class KernelLogBuffer
     {
       public:
-        const static inline QString QV2RAYBASE_DEFAULT_KERNEL_PLACEHOLDER = "__default__";
+        explicit KernelLogBuffer(qsizetype capacity = 4096);
+        void Push(QString &&line);
+        QStringList TakeAll();
+        quint64 TakeDropped();
+        bool IsEmpty() const
+        {
+            return size == 0;
+        }
+
+      private:
+        std::vector<QString> ring;
+        qsizetype head = 0;
+        qsizetype size = 0;
+        quint64 dropped = 0;
+    };
+
+    ///
+    /// \brief Recent crashes of one profile, for the restart backoff and the crash-loop breaker.
+    ///
+    struct KernelCrashState
+    {
+        int consecutiveCrashes = 0;
+        QList<qint64> crashTimes;
+    };
+
+    ///
+    /// \brief Kernels and states of one running profile.
+    ///
+    struct KernelSession
+    {
+        ProfileId id;
+        // Identifies this start of the profile, a profile may be restarted while it's being probed.
+        quint64 serial = 0;
+        ProfileContent profile;
+        // The profile sent to the default kernel, with plugin outbounds replaced.
+        ProfileContent fullProfile;
+        qint64 startedAt = 0;
+        KernelList kernels;
         QMap<QString, IOBoundData> inboundInfo;
         QMap<QString, IOBoundData> outboundInfo;
-        qsizetype logPadding = 0;
-        ProfileId current;
-        std::list<std::pair<QString, std::unique_ptr<Qv2rayPlugin::PluginKernel>>> kernels;
+        // Local ports reserved by this session, for the plugin kernels and the inbounds.
+        QSet<int> reservedPorts;
+        QList<KernelTiming> timings;
+        // Milliseconds from starting the kernels until the inbounds accept connections, -1 if unknown.
+        qint64 readyTime = -1;
+        // OnConnected has been emitted, a session stopped while being probed is never reported as disconnected.
+        bool connected = false;
+        KernelLogBuffer logBuffer;
+        // Carried over from the crashed session when the supervisor restarts the profile.
+        KernelCrashState crashState;
+    };
+
+    class KernelManagerPrivate
+    {
+      public:
+        const static inline QString QV2RAYBASE_DEFAULT_KERNEL_PLACEHOLDER = "__default__";
+        // Running profiles, the first one is the current connection.
+        std::list<KernelSession> sessions;
+        quint64 sessionSerial = 0;
+        // Kernels prepared but not started for the likely next profile.
+        std::shared_ptr<KernelSession> prefetched;
+        quint64 prefetchSerial = 0;
+        // Profile of every running kernel, and their log prefixes resolved when they are started.
+        QHash<const QObject *, ProfileId> kernelOwners;
+        QHash<const QObject *, QString> kernelLogPrefixes;
+        int logTimerId = 0;
+        quint64 droppedLogLines = 0;
+        std::unique_ptr<KernelLogWriter> logWriter;
+        AccessLogAggregator accessLog;
+
+        // Kernel supervisor, pending restarts are keyed by their timer id.
+        struct PendingRestart
+        {
+            ProfileId id;
+            ProfileContent profile;
+            // Position of the crashed session, the restarted one takes its place.
+            qsizetype position;
+            KernelCrashState crashState;
+        };
+        QHash<int, PendingRestart> pendingRestarts;
+        KernelSupervisorStatistics supervisorStatistics;
+
+        // Kernel resource monitor
+        struct KernelProcessState
+        {
+            ProcessSampler::Sample lastSample;
+            KernelResourceUsage usage;
+            bool alerted = false;
+        };
+        int monitorTimerId = 0;
+        QHash<const QObject *, KernelProcessState> kernelProcesses;
+
+        // StatsService API poller, it follows the current connection.
+        std::unique_ptr<StatsServiceClient> statsClient;
+        int statsTimerId = 0;
+        ProfileId statsConnection;
+        // Kernel reported traffic of the polled connection is ignored only while the API answers.
+        bool statsServiceAvailable = false;
+        KernelTrafficStatistics trafficStatistics;
     };
 } // namespace Qv2rayBase::Profile
@@ -0,0 +1,85 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+
+#pragma once
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QTimer>
+
+#include <optional>
+
+class QTcpSocket;
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief Waits for the inbounds of started kernels to accept TCP connections.
+    /// Sockets and timers run on the thread of the probe, nothing blocks while waiting.
+    /// Qt sockets are used instead of libuv: the probe lives on the event loop of the kernel manager,
+    /// a uv loop would need a thread of its own or a blocking run, for a handful of local connects.
+    ///
+    class KernelReadinessProbe : public QObject
+    {
+        Q_OBJECT
+      public:
+        struct Endpoint
+        {
+            QHostAddress address;
+            quint16 port;
+        };
+
+        explicit KernelReadinessProbe(const QList<Endpoint> &endpoints, qint64 timeout, QObject *parent = nullptr);
+
+        ///
+        /// \brief Start Connect to every endpoint until all of them accept, retrying with backoff.
+        ///
+        void Start();
+
+      signals:
+        ///
+        /// \brief OnFinished Emitted once, with the milliseconds until all endpoints were ready, std::nullopt when the timeout elapsed first.
+        ///
+        void OnFinished(std::optional<qint64> readyTime);
+
+      private:
+        // Connect to all pending endpoints at once.
+        void tryConnect();
+        void onAttemptFinished(QTcpSocket *socket, bool connected);
+        void finish(std::optional<qint64> readyTime);
+
+      private:
+        QList<Endpoint> pending;
+        const qint64 timeout;
+        qint64 delay;
+        QElapsedTimer elapsed;
+        QTimer deadline;
+        QTimer retry;
+        // Attempts of the current round, in the order of the pending endpoints.
+        QList<QTcpSocket *> attempts;
+        quint64 round = 0;
+        bool finished = false;
+    };
+} // namespace Qv2rayBase::Profile
@@ -0,0 +1,73 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <array>
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief A fixed-size ring of the most recent latency test results of a connection.
+    /// Samples are kept as 16-bit milliseconds, failed tests are stored as FailedSample.
+    ///
+    class LatencyHistory
+    {
+      public:
+        constexpr static int Capacity = 32;
+        constexpr static quint16 FailedSample = 0xFFFF;
+
+        ///
+        /// \brief IsSuccessful Whether a test result is a measured latency, results below 1ms are reported as 0.
+        ///
+        static bool IsSuccessful(long latency);
+
+        void Push(int latency);
+        int Size() const;
+        int FailedCount() const;
+
+        ///
+        /// \brief Percentile Nearest-rank percentile of successful samples, -1 when there's no successful sample.
+        ///
+        int Percentile(int percent) const;
+
+        ///
+        /// \brief Jitter Mean absolute difference between consecutive successful samples.
+        ///
+        int Jitter() const;
+
+        QByteArray Serialize() const;
+        static LatencyHistory Deserialize(const QByteArray &data);
+
+      private:
+        // Successful samples, from the oldest to the newest.
+        QList<quint16> successfulSamples() const;
+
+        std::array<quint16, Capacity> samples{};
+        int head = 0;
+        int count = 0;
+    };
+} // namespace Qv2rayBase::Profile
@@ -0,0 +1,57 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+
+#pragma once
+
+#include <QtGlobal>
+#include <optional>
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief Reads resource usage of a process from /proc, only available on Linux.
+    ///
+    class ProcessSampler
+    {
+      public:
+        struct Sample
+        {
+            // Monotonic time when the sample is taken, in milliseconds.
+            qint64 time = 0;
+            quint64 cpuTicks = 0;
+            qint64 rss = 0;
+            int threads = 0;
+            quint64 readBytes = 0;
+            quint64 writeBytes = 0;
+        };
+
+        static std::optional<Sample> Read(qint64 pid);
+
+        ///
+        /// \brief CpuUsage Percentage of one CPU core used between two samples.
+        ///
+        static double CpuUsage(const Sample &previous, const Sample &current);
+    };
+} // namespace Qv2rayBase::Profile
@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include "Qv2rayBase/private/Profile/ConnectionIndex_p.hpp"
+#include "Qv2rayBase/private/Profile/LatencyHistory_p.hpp"
+#include "Qv2rayBase/private/Profile/TrafficHistory_p.hpp"
 #include "QvPlugin/PluginInterface.hpp"
 
 namespace Qv2rayBase::Profile
@@ -36,5 +39,21 @@ namespace Qv2rayBase::Profile
         QHash<ConnectionId, ConnectionObject> connections;
         QHash<RoutingId, RoutingObject> routings;
         QHash<ConnectionId, ProfileContent> connectionRootCache;
+        ConnectionIndex connectionIndex;
+        QHash<ConnectionId, LatencyHistory> latencyHistory;
+        bool latencyHistoryChanged = false;
+        QHash<ConnectionId, TrafficHistory> trafficHistory;
+        // Serialized histories as stored, only the dirty ones are serialized again on save.
+        QJsonObject storedTrafficHistory;
+        QSet<ConnectionId> dirtyTrafficHistory;
+
+        // Coalesced statistics events
+        int statsEventTimerId = 0;
+        QSet<ConnectionId> pendingStatsEvents;
+
+        // Automatic failover, for the connection which was current when it was started.
+        ProfileId failoverConnection;
+        int failoverTimerId = 0;
+        int failoverFailedProbes = 0;
     };
 } // namespace Qv2rayBase::Profile
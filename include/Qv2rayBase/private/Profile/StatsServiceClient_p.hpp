@@ -0,0 +1,83 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+
+#pragma once
+#include <QNetworkAccessManager>
+#include <QUrl>
+
+#include <functional>
+#include <optional>
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief A minimal gRPC client of the V2Ray StatsService (assets/v2ray_api.proto), over cleartext HTTP/2.
+    ///
+    class StatsServiceClient : public QObject
+    {
+        Q_OBJECT
+      public:
+        using StatList = QList<std::pair<QString, qint64>>;
+        struct SysStats
+        {
+            quint32 numGoroutine = 0;
+            quint32 numGC = 0;
+            quint64 alloc = 0;
+            quint64 totalAlloc = 0;
+            quint64 sys = 0;
+            quint64 mallocs = 0;
+            quint64 frees = 0;
+            quint64 liveObjects = 0;
+            quint64 pauseTotalNs = 0;
+            quint32 uptime = 0;
+        };
+
+        explicit StatsServiceClient(const QString &host, int port, QObject *parent = nullptr);
+
+        // Calls are skipped while the previous one of the same method is still running.
+        void QueryStats(const QString &pattern, bool reset);
+        void GetSysStats();
+
+        // Protobuf messages and gRPC message framing.
+        static QByteArray EncodeQueryStatsRequest(const QString &pattern, bool reset);
+        static std::optional<StatList> DecodeQueryStatsResponse(const QByteArray &message);
+        static std::optional<SysStats> DecodeSysStatsResponse(const QByteArray &message);
+        static QByteArray FrameMessage(const QByteArray &message);
+        static std::optional<QByteArray> UnframeMessage(const QByteArray &body);
+
+      signals:
+        void OnStatsReceived(const StatList &stats);
+        void OnSysStatsReceived(const SysStats &stats);
+        void OnError(const QString &method, const QString &error);
+
+      private:
+        void Call(const QString &method, const QByteArray &message, const std::function<void(const QByteArray &)> &handler);
+
+      private:
+        QNetworkAccessManager manager;
+        QUrl baseUrl;
+        QSet<QString> runningCalls;
+    };
+} // namespace Qv2rayBase::Profile
@@ -0,0 +1,74 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// ************************ WARNING ************************
+//
+// This file is NOT part of the Qv2rayBase API.
+// It may change at any time without notice, or even be removed.
+// USE IT AT YOUR OWN RISK
+//
+// ************************ WARNING ************************
+
+#pragma once
+
+#include "Qv2rayBase/Profile/ProfileManager.hpp"
+
+#include <array>
+
+namespace Qv2rayBase::Profile
+{
+    ///
+    /// \brief Traffic deltas of a connection, aggregated into per-second, per-minute and per-hour rings,
+    /// together with exponentially weighted moving average of the throughput.
+    ///
+    class TrafficHistory
+    {
+      public:
+        void Append(const StatisticsObject &delta, qint64 msecsSinceEpoch);
+
+        ///
+        /// \brief History Returns all buckets of a resolution from the oldest to the newest, missing buckets are zero.
+        ///
+        QList<StatisticsObject> History(TrafficHistoryResolution resolution, qint64 msecsSinceEpoch) const;
+
+        ///
+        /// \brief Rate Returns the smoothed throughput in bytes per second.
+        ///
+        StatisticsObject Rate(qint64 msecsSinceEpoch) const;
+
+        QByteArray Serialize() const;
+        static TrafficHistory Deserialize(const QByteArray &data);
+
+      private:
+        constexpr static int ResolutionCount = 3;
+        constexpr static std::array<qint64, ResolutionCount> BucketSeconds{ 1, 60, 3600 };
+        constexpr static std::array<int, ResolutionCount> BucketCount{ 120, 120, 168 };
+
+        // Time constant of the moving average, in seconds.
+        constexpr static double RateTimeConstant = 5.0;
+
+        struct Bucket
+        {
+            // Start of the bucket in seconds since epoch, zero for an empty bucket.
+            qint64 time = 0;
+            std::array<quint64, 4> values{};
+        };
+
+        std::array<QList<Bucket>, ResolutionCount> rings;
+        std::array<double, 4> rates{};
+        qint64 lastUpdate = 0;
+    };
+} // namespace Qv2rayBase::Profile
@@ -20,9 +20,12 @@
 #include "Qv2rayBase/Plugin/PluginAPIHost.hpp"
 #include "Qv2rayBase/Profile/ProfileManager.hpp"
 #include "Qv2rayBase/Qv2rayBaseLibrary.hpp"
+#include "Qv2rayBase/private/Common/PortAllocator_p.hpp"
 
 namespace Qv2rayBase::Utils
 {
+    using namespace Qv2rayBase::_private;
+
     int GetConnectionLatency(const ConnectionId &id)
     {
         const auto connection = Qv2rayBaseLibrary::ProfileManager()->GetConnectionObject(id);
@@ -161,6 +164,10 @@ namespace Qv2rayBase::Utils
         QList<InboundObject> chainingInbounds;
         QList<RuleObject> chainingRules;
 
+        QSet<int> usedPorts;
+        for (const auto &in : inbounds)
+            usedPorts << std::get<2>(GetInboundInfo(in)).from;
+
         // First pass - Resolve Indexes (tags), build cache
         QMap<QString, OutboundObject> outboundCache;
         for (const auto &outbound : outbounds)
@@ -184,7 +191,19 @@ namespace Qv2rayBase::Utils
                 continue;
             }
 
-            int nextInboundPort = outbound.chainSettings.chaining_port;
+            // Chain inbounds only listen on free local ports, starting from the configured one.
+            // The ports are only probed here, the kernel session running the profile reserves them.
+            const auto chainPortCount = outbound.chainSettings.chains.count() - 1;
+            const auto chainPorts = PortAllocator::FindAvailablePorts(outbound.chainSettings.chaining_port, chainPortCount, usedPorts);
+            if (chainPorts.size() < chainPortCount)
+            {
+                qInfo() << "Cannot build outbound chain: Not enough free ports for:" << outbound.name;
+                return false;
+            }
+            usedPorts += QSet<int>{ chainPorts.cbegin(), chainPorts.cend() };
+
+            qsizetype chainPortIndex = 0;
+            int nextInboundPort = chainPorts.value(chainPortIndex);
             const auto firstOutboundTag = outbound.name;
             const auto lastOutboundTag = outbound.chainSettings.chains.first();
 
@@ -234,7 +253,7 @@ namespace Qv2rayBase::Utils
                     newInbound.inboundSettings.port = nextInboundPort;
                     newInbound.inboundSettings.protocolSettings = inboundSettings;
 
-                    nextInboundPort++;
+                    nextInboundPort = chainPorts.value(++chainPortIndex);
                     chainingInbounds << newInbound;
                     //
                     RuleObject ruleObject;
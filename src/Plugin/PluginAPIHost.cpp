@@ -18,13 +18,20 @@
 #include "Qv2rayBase/Plugin/PluginAPIHost.hpp"
 
 #include "Qv2rayBase/Common/Utils.hpp"
+#include "Qv2rayBase/Plugin/LatencyTestHost.hpp"
 #include "Qv2rayBase/Plugin/PluginManagerCore.hpp"
 #include "Qv2rayBase/Qv2rayBaseLibrary.hpp"
 #include "Qv2rayBase/private/Plugin/PluginAPIHost_p.hpp"
 #include "Qv2rayBase/private/Plugin/PluginManagerCore_p.hpp"
 
+#include <QElapsedTimer>
+#include <algorithm>
+
 using namespace Qv2rayPlugin;
 
+constexpr auto STATS_EVENT_HANDLER_BUDGET_MS = 20;
+constexpr auto STATS_EVENT_MAX_PENALTY = 64;
+
 namespace Qv2rayBase::Plugin
 {
     using namespace Qv2rayPlugin::Event;
@@ -32,8 +39,26 @@ namespace Qv2rayBase::Plugin
     using namespace Qv2rayPlugin::Outbound;
     using namespace Qv2rayPlugin::Subscription;
 
+    static void RegisterBuiltinLatencyTestEngines(PluginAPIHostPrivate *d)
+    {
+#ifndef QV2RAYBASE_NO_LIBUV
+        // Run by the latency test thread itself, there's no engine object to create and Create() returns null.
+        LatencyTestEngineInfo builtin;
+        builtin.Id = BuiltinTcpLatencyTestEngineId;
+        builtin.isAsync = true;
+        builtin.Name = QObject::tr("TCP Connect");
+        builtin.Description = QObject::tr("Measures how long a TCP connection to the server takes.");
+        builtin.Create = []() { return nullptr; };
+        d->latencyTesters.insert(builtin.Id, builtin);
+#else
+        Q_UNUSED(d);
+#endif
+    }
+
     PluginAPIHost::PluginAPIHost() : d_ptr(new PluginAPIHostPrivate)
     {
+        // Built-in engines are available even when plugins are not loaded.
+        RegisterBuiltinLatencyTestEngines(d_ptr.data());
     }
 
     PluginAPIHost::~PluginAPIHost()
@@ -43,10 +68,36 @@ namespace Qv2rayBase::Plugin
     void PluginAPIHost::InitializePlugins()
     {
         Q_D(PluginAPIHost);
+        d->kernels.clear();
+        d->protocolKernels.clear();
+        d->kernelRanks.clear();
+        d->defaultKernel = NullKernelId;
+        d->latencyTesters.clear();
+
         for (const auto &plugin : Qv2rayBaseLibrary::PluginManagerCore()->GetPlugins(COMPONENT_KERNEL))
             for (const auto &kinterface : plugin->pinterface->KernelInterface()->PluginKernels())
                 d->kernels.insert(kinterface.Id, kinterface);
 
+        // Kernels supporting more protocols come first, ties are broken by the kernel id to keep the choice stable.
+        auto ranked = d->kernels.values();
+        std::sort(ranked.begin(), ranked.end(),
+                  [](const KernelFactory &a, const KernelFactory &b)
+                  {
+                      if (a.SupportedProtocols.size() != b.SupportedProtocols.size())
+                          return a.SupportedProtocols.size() > b.SupportedProtocols.size();
+                      return a.Id.toString() < b.Id.toString();
+                  });
+
+        for (const auto &k : ranked)
+        {
+            d->kernelRanks.insert(k.Id, d->kernelRanks.size());
+            for (const auto &protocol : k.SupportedProtocols)
+                d->protocolKernels[protocol].append(k.Id);
+            if (d->defaultKernel.isNull() && k.Capabilities.testFlag(KERNELCAP_ROUTER))
+                d->defaultKernel = k.Id;
+        }
+
+        RegisterBuiltinLatencyTestEngines(d);
         for (const auto &plugin : Qv2rayBaseLibrary::PluginManagerCore()->GetPlugins(COMPONENT_LATENCY_TEST_ENGINE))
             for (const auto &linterface : plugin->pinterface->LatencyTestHandler()->PluginLatencyTestEngines())
                 d->latencyTesters.insert(linterface.Id, linterface);
@@ -79,32 +130,33 @@ namespace Qv2rayBase::Plugin
     KernelId PluginAPIHost::Kernel_GetDefaultKernel() const
     {
         Q_D(const PluginAPIHost);
-        qsizetype supportedProtocolsCount = 0;
-        KernelId result;
-        for (auto it = d->kernels.constKeyValueBegin(); it != d->kernels.constKeyValueEnd(); it++)
-        {
-            if (it->second.Capabilities.testFlag(KERNELCAP_ROUTER))
-                if (it->second.SupportedProtocols.size() > supportedProtocolsCount)
-                    result = it->first, supportedProtocolsCount = it->second.SupportedProtocols.size();
-        }
-        return result;
+        return d->defaultKernel;
     }
 
     KernelId PluginAPIHost::Kernel_QueryProtocol(const QSet<QString> &protocols) const
     {
         Q_D(const PluginAPIHost);
-        const KernelFactory *bestMatch = nullptr;
+        if (protocols.size() == 1)
+        {
+            const auto it = d->protocolKernels.constFind(*protocols.constBegin());
+            return it == d->protocolKernels.constEnd() ? NullKernelId : it->constFirst();
+        }
+
+        // Count how many of the requested protocols each kernel supports, only looking at kernels that support any of them.
+        QHash<KernelId, qsizetype> intersections;
+        for (const auto &protocol : protocols)
+            for (const auto &kid : d->protocolKernels.value(protocol))
+                ++intersections[kid];
+
+        // The iteration order of the sets is arbitrary, ties are broken by the ranking of the kernels.
+        KernelId bestMatch = NullKernelId;
         qsizetype maxIntersections = 0;
-        for (const auto &k : d->kernels)
+        for (auto it = intersections.constKeyValueBegin(); it != intersections.constKeyValueEnd(); it++)
         {
-            const auto intersection = (k.SupportedProtocols & protocols).size();
-            if (maxIntersections < intersection)
-            {
-                maxIntersections = intersection;
-                bestMatch = &k;
-            }
+            if (maxIntersections < it->second || (maxIntersections == it->second && d->kernelRanks.value(it->first) < d->kernelRanks.value(bestMatch)))
+                maxIntersections = it->second, bestMatch = it->first;
         }
-        return bestMatch ? bestMatch->Id : NullKernelId;
+        return bestMatch;
     }
 
     std::optional<PluginIOBoundData> PluginAPIHost::Outbound_GetData(const IOConnectionSettings &o) const
@@ -216,10 +268,59 @@ namespace Qv2rayBase::Plugin
         return profile;
     }
 
+    static void DeliverStatsEvents(const PluginInfo *plugin, PluginAPIHostPrivate::StatsEventState &state)
+    {
+        if (state.pending.isEmpty())
+            return;
+
+        // Statistics are cumulative, the latest event of each connection is kept until the plugin is ready.
+        if (state.skipped < state.penalty)
+        {
+            state.skipped++;
+            return;
+        }
+        state.skipped = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (const auto &event : std::exchange(state.pending, {}))
+            plugin->pinterface->EventHandler()->ProcessEvent(event);
+
+        if (const auto elapsed = timer.elapsed(); elapsed > STATS_EVENT_HANDLER_BUDGET_MS)
+        {
+            state.penalty = std::clamp(state.penalty * 2, 1, STATS_EVENT_MAX_PENALTY);
+            qInfo() << "Plugin" << plugin->metadata().Name << "took" << elapsed << "ms to process statistics, skipping" << state.penalty << "events.";
+        }
+        else
+        {
+            state.penalty /= 2;
+        }
+    }
+
+    bool PluginAPIHost::Event_SendPendingStats() const
+    {
+        Q_D(const PluginAPIHost);
+        bool hasPending = false;
+        for (const auto &plugin : Qv2rayBaseLibrary::PluginManagerCore()->GetPlugins(Qv2rayPlugin::COMPONENT_EVENT_HANDLER))
+        {
+            auto &state = d->statsEventStates[plugin->pinterface];
+            DeliverStatsEvents(plugin, state);
+            hasPending |= !state.pending.isEmpty();
+        }
+        return hasPending;
+    }
+
     void PluginAPIHost::SendEventInternal(const ConnectionStats::EventObject &object) const
     {
+        Q_D(const PluginAPIHost);
+        // Events are keyed by their connection, the statistics are always the latest totals.
+        [[maybe_unused]] const auto &[connection, statistics] = object;
         for (const auto &plugin : Qv2rayBaseLibrary::PluginManagerCore()->GetPlugins(Qv2rayPlugin::COMPONENT_EVENT_HANDLER))
-            plugin->pinterface->EventHandler()->ProcessEvent(object);
+        {
+            auto &state = d->statsEventStates[plugin->pinterface];
+            state.pending.insert(connection, object);
+            DeliverStatsEvents(plugin, state);
+        }
     }
 
     void PluginAPIHost::SendEventInternal(const Connectivity::EventObject &object) const
@@ -18,66 +18,182 @@
 
 #include "Qv2rayBase/Common/Settings.hpp"
 #include "Qv2rayBase/Common/Utils.hpp"
+#include "Qv2rayBase/Interfaces/IStorageProvider.hpp"
+#include "Qv2rayBase/private/Common/PortAllocator_p.hpp"
 #include "Qv2rayBase/private/Profile/KernelManager_p.hpp"
 #include "QvPlugin/Handlers/KernelHandler.hpp"
 
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QTimerEvent>
+
+#if QT_CONFIG(process)
+#include <QProcess>
+#endif
+
+#if QT_CONFIG(concurrent)
+#include <QtConcurrent/QtConcurrent>
+#endif
+
+constexpr auto KERNEL_LOG_FLUSH_INTERVAL = 100;
+constexpr qint64 KERNEL_RESTART_BASE_DELAY = 1000;
+constexpr qint64 KERNEL_RESTART_MAX_DELAY = 30'000;
+constexpr qint64 KERNEL_RESTART_STABLE_UPTIME = 60'000;
+
 namespace Qv2rayBase::Profile
 {
     using namespace Qv2rayPlugin::Kernel;
     using namespace Qv2rayPlugin::Outbound;
     using namespace Qv2rayPlugin::Event;
+    using namespace Qv2rayBase::_private;
 
     KernelManager::KernelManager(QObject *parent) : QObject(parent)
     {
         d_ptr.reset(new KernelManagerPrivate);
+
+        const auto &config = Qv2rayBaseLibrary::GetConfig()->kernel_config;
+        if (config.log_file_enabled)
+        {
+            Q_D(KernelManager);
+            KernelLogWriter::Options options;
+            options.directory = QDir(Qv2rayBaseLibrary::StorageProvider()->StorageLocation()).filePath(u"logs"_qs);
+            options.maxSize = std::max(1, config.log_file_max_size) * 1024LL * 1024LL;
+            options.maxAge = std::max(0, config.log_file_max_age) * 3600LL * 1000LL;
+            options.keepCount = std::max(0, config.log_file_keep_count);
+            options.compress = config.log_file_compress;
+            d->logWriter = std::make_unique<KernelLogWriter>(options);
+            d->logWriter->start(QThread::LowPriority);
+        }
+    }
+
+    template<typename Sessions>
+    static auto FindSession(Sessions &sessions, const ProfileId &id)
+    {
+        return std::find_if(sessions.begin(), sessions.end(), [&](const KernelSession &s) { return s.id == id; });
+    }
+
+    template<typename Sessions>
+    static qsizetype SessionPosition(Sessions &sessions, const ProfileId &id)
+    {
+        const auto it = FindSession(sessions, id);
+        return it == sessions.end() ? -1 : std::distance(sessions.begin(), it);
     }
 
     size_t KernelManager::ActiveKernelCount() const
     {
         Q_D(const KernelManager);
-        return d->kernels.size();
+        size_t count = 0;
+        for (const auto &session : d->sessions)
+            count += session.kernels.size();
+        return count;
     }
 
     const QMap<QString, IOBoundData> KernelManager::GetCurrentConnectionInboundInfo() const
+    {
+        return GetConnectionInboundInfo(CurrentConnection());
+    }
+
+    const QMap<QString, IOBoundData> KernelManager::GetConnectionInboundInfo(const ProfileId &id) const
+    {
+        Q_D(const KernelManager);
+        const auto it = FindSession(d->sessions, id);
+        return it == d->sessions.end() ? QMap<QString, IOBoundData>{} : it->inboundInfo;
+    }
+
+    const QList<KernelTiming> KernelManager::GetKernelTimings(const ProfileId &id) const
+    {
+        Q_D(const KernelManager);
+        const auto it = FindSession(d->sessions, id.isNull() ? CurrentConnection() : id);
+        return it == d->sessions.end() ? QList<KernelTiming>{} : it->timings;
+    }
+
+    qint64 KernelManager::GetConnectionReadyTime(const ProfileId &id) const
     {
         Q_D(const KernelManager);
-        return d->inboundInfo;
+        const auto it = FindSession(d->sessions, id.isNull() ? CurrentConnection() : id);
+        return it == d->sessions.end() ? -1 : it->readyTime;
     }
 
     const ProfileId KernelManager::CurrentConnection() const
     {
         Q_D(const KernelManager);
-        return d->current;
+        return d->sessions.empty() ? ProfileId{} : d->sessions.front().id;
     }
 
-    KernelManager::~KernelManager()
+    const QList<ProfileId> KernelManager::ActiveConnections() const
     {
-        StopConnection();
+        Q_D(const KernelManager);
+        QList<ProfileId> result;
+        for (const auto &session : d->sessions)
+            result << session.id;
+        return result;
     }
 
-    std::optional<QString> KernelManager::StartConnection(const ProfileId &id, const ProfileContent &_root)
+    bool KernelManager::IsConnected(const ProfileId &id) const
+    {
+        Q_D(const KernelManager);
+        return FindSession(d->sessions, id) != d->sessions.end();
+    }
+
+    KernelManager::~KernelManager()
     {
-        Q_D(KernelManager);
         StopConnection();
-        Q_ASSERT_X(d->kernels.empty(), Q_FUNC_INFO, "Kernel list isn't empty.");
+        p_DiscardPrefetched();
+    }
 
-        auto fullProfile = _root;
-        //
-        // Ensure every inbound, rule and outbound has a name.
-        for (auto &in : fullProfile.inbounds)
+    // Ensure every inbound, rule and outbound has a name.
+    static void AssignNames(ProfileContent &profile)
+    {
+        for (auto &in : profile.inbounds)
             if (in.name.isEmpty())
                 in.name = GenerateRandomString();
-        for (auto &out : fullProfile.outbounds)
+        for (auto &out : profile.outbounds)
             if (out.name.isEmpty())
                 out.name = GenerateRandomString();
-        for (auto &rule : fullProfile.routing.rules)
+        for (auto &rule : profile.routing.rules)
             if (rule.name.isEmpty())
                 rule.name = GenerateRandomString();
+    }
+
+    // Unnamed objects take the names given when the profile was started, so that unchanged objects compare equal.
+    template<typename T>
+    static void CarryOverNames(QList<T> &objects, const QList<T> &startedRoot, const QList<T> &startedFull)
+    {
+        for (qsizetype i = 0; i < objects.size() && i < startedRoot.size() && i < startedFull.size(); i++)
+            if (objects[i].name.isEmpty() && startedRoot[i].name.isEmpty())
+                objects[i].name = startedFull[i].name;
+    }
+
+    // Kernels may support applying a new configuration with an optional "bool ReloadProfileContent(QJsonObject)" invokable method.
+    static bool CanReloadProfileContent(const PluginKernel *kernel)
+    {
+        return kernel->metaObject()->indexOfMethod("ReloadProfileContent(QJsonObject)") >= 0;
+    }
 
-        // In case of the configuration did not specify a kernel explicitly
-        // find a kernel with router, and with as many protocols supported as possible.
-        auto defaultKid = fullProfile.defaultKernel.isNull() ? Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetDefaultKernel() : fullProfile.defaultKernel;
-        const auto defaultKernelInfo = Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(defaultKid);
+    // In case of the configuration did not specify a kernel explicitly
+    // find a kernel with router, and with as many protocols supported as possible.
+    static Qv2rayPlugin::KernelFactory GetDefaultKernelInfo(const ProfileContent &profile)
+    {
+        const auto defaultKid = profile.defaultKernel.isNull() ? Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetDefaultKernel() : profile.defaultKernel;
+        return Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(defaultKid);
+    }
+
+    static std::optional<QString> PrepareKernels(const ProfileContent &root, ProfileContent &fullProfile, KernelList &kernels, QSet<int> &reservedPorts, QList<KernelTiming> &timings,
+                                                 bool parallel = true)
+    {
+        fullProfile = root;
+        AssignNames(fullProfile);
+
+        // The inbound ports, including the chain ports found by ExpandProfileChains, are reserved while the session runs.
+        // Only the ports handed out to this session are recorded, those of another session are not released by this one.
+        QSet<int> inboundPorts;
+        for (const auto &in : fullProfile.inbounds)
+            inboundPorts << std::get<2>(GetInboundInfo(in)).from;
+        reservedPorts = PortAllocator::ClaimPorts(inboundPorts);
+
+        const auto defaultKernelInfo = GetDefaultKernelInfo(fullProfile);
 
         // Leave, nothing can be found.
         if (defaultKernelInfo.Name.isEmpty())
@@ -94,9 +210,25 @@ namespace Qv2rayBase::Profile
         // Remove protocols which are already supported by the main kernel
         protocols -= defaultKernelInfo.SupportedProtocols;
 
+        // Reserve local ports for all plugin kernels at once, before any of them is created.
+        // Ports of the running kernels are still reserved and are skipped as well.
+        QList<int> availablePorts;
+        {
+            const auto pluginOutboundCount = static_cast<int>(std::count_if(fullProfile.outbounds.cbegin(), fullProfile.outbounds.cend(), [&](const OutboundObject &o)
+                                                                            { return !defaultKernelInfo.SupportedProtocols.contains(o.outboundSettings.protocol); }));
+
+            availablePorts = PortAllocator::ReservePorts(Qv2rayBaseLibrary::GetConfig()->plugin_config.plugin_port_allocation, pluginOutboundCount, inboundPorts);
+            reservedPorts += QSet<int>{ availablePorts.cbegin(), availablePorts.cend() };
+            if (availablePorts.size() < pluginOutboundCount)
+                return KernelManager::tr("Cannot find enough free local ports for plugin kernels.");
+        }
+
+        // Kernels providing an optional "bool AddConnectionSettings(int, QJsonObject)" invokable method
+        // serve every outbound of their protocol in one instance, with a SOCKS listener for each outbound.
+        QHash<QString, PluginKernel *> sharedKernels;
+
         // Process outbounds.
         QList<OutboundObject> processedOutbounds;
-        auto pluginPort = Qv2rayBaseLibrary::GetConfig()->plugin_config.plugin_port_allocation;
         for (const auto &_out : fullProfile.outbounds)
         {
             auto outbound = _out;
@@ -112,22 +244,37 @@ namespace Qv2rayBase::Profile
             {
                 // Expected a plugin, but found nothing
                 qInfo() << "Outbound protocol" << outbound.outboundSettings.protocol << "is not a registered plugin outbound.";
-                return tr("Cannot find a kernel for outbound protocol: ") + outbound.outboundSettings.protocol;
+                return KernelManager::tr("Cannot find a kernel for outbound protocol: ") + outbound.outboundSettings.protocol;
             }
 
-            const auto kinfo = Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(kid);
-            auto pkernel = kinfo.Create();
-
+            const auto pluginPort = availablePorts.takeFirst();
+            bool shared = false;
+            if (const auto sharedKernel = sharedKernels.value(outbound.outboundSettings.protocol); sharedKernel)
             {
-                QMap<KernelOptionFlags, QVariant> kernelOption;
-                kernelOption.insert(KERNEL_SOCKS_ENABLED, true);
-                kernelOption.insert(KERNEL_SOCKS_PORT, pluginPort);
-                kernelOption.insert(KERNEL_LISTEN_ADDRESS, "127.0.0.1");
-                qInfo() << "Sending connection settings to kernel.";
-                pkernel->SetConnectionSettings(kernelOption, outbound.outboundSettings);
+                qInfo() << "Adding connection settings to the shared kernel for" << outbound.outboundSettings.protocol;
+                QMetaObject::invokeMethod(sharedKernel, "AddConnectionSettings", Qt::DirectConnection, Q_RETURN_ARG(bool, shared), Q_ARG(int, pluginPort),
+                                          Q_ARG(QJsonObject, outbound.outboundSettings.toJson()));
             }
 
-            d->kernels.push_back({ outbound.outboundSettings.protocol, std::move(pkernel) });
+            if (!shared)
+            {
+                const auto kinfo = Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(kid);
+                auto pkernel = kinfo.Create();
+
+                {
+                    QMap<KernelOptionFlags, QVariant> kernelOption;
+                    kernelOption.insert(KERNEL_SOCKS_ENABLED, true);
+                    kernelOption.insert(KERNEL_SOCKS_PORT, pluginPort);
+                    kernelOption.insert(KERNEL_LISTEN_ADDRESS, "127.0.0.1");
+                    qInfo() << "Sending connection settings to kernel.";
+                    pkernel->SetConnectionSettings(kernelOption, outbound.outboundSettings);
+                }
+
+                if (pkernel->metaObject()->indexOfMethod("AddConnectionSettings(int,QJsonObject)") >= 0)
+                    sharedKernels.insert(outbound.outboundSettings.protocol, pkernel.get());
+
+                kernels.push_back({ outbound.outboundSettings.protocol, std::move(pkernel) });
+            }
 
             IOConnectionSettings pluginOutSettings;
             pluginOutSettings.protocolSettings = IOProtocolSettings{ QJsonObject{ { "address", "127.0.0.1" }, { "port", pluginPort } } };
@@ -136,111 +283,860 @@ namespace Qv2rayBase::Profile
 
             // Add the integration outbound to the list.
             processedOutbounds.append(outbound);
-            pluginPort++;
         }
 
         qInfo() << "Applying new outbound settings.";
         fullProfile.outbounds = processedOutbounds;
 
-        bool hasAllKernelPrepared = true;
-        for (auto &[protocol, kernel] : d->kernels)
+        // The default kernel always comes last.
+        auto defaultKernel = defaultKernelInfo.Create();
+        defaultKernel->SetProfileContent(fullProfile);
+        kernels.push_back({ KernelManagerPrivate::QV2RAYBASE_DEFAULT_KERNEL_PLACEHOLDER, std::move(defaultKernel) });
+
+        const auto prepare = [](PluginKernel *kernel) -> std::pair<bool, qint64>
+        {
+            QElapsedTimer timer;
+            timer.start();
+            const auto result = kernel->PrepareConfigurations();
+            return { result, timer.elapsed() };
+        };
+
+        // Kernels do not depend on each other, prepare them concurrently and wait for all of them.
+        QList<std::pair<bool, qint64>> results;
+        results.reserve(kernels.size());
+#if QT_CONFIG(concurrent)
+        if (parallel && kernels.size() > 1)
+        {
+            // Kernels are QObjects living on this thread, each of them is moved to the worker preparing it, and back.
+            // An object without thread affinity is the only one which may be pulled into another thread.
+            const auto origin = QThread::currentThread();
+            const auto prepareOnWorker = [origin, prepare](PluginKernel *kernel)
+            {
+                kernel->moveToThread(QThread::currentThread());
+                const auto result = prepare(kernel);
+                kernel->moveToThread(origin);
+                return result;
+            };
+
+            QList<QFuture<std::pair<bool, qint64>>> futures;
+            for (const auto &[name, kernel] : kernels)
+            {
+                qInfo() << "Preparing kernel for starting:" << name;
+                kernel->moveToThread(nullptr);
+                futures << QtConcurrent::run(prepareOnWorker, kernel.get());
+            }
+            for (auto &future : futures)
+                results << future.result();
+        }
+        else
+#endif
         {
-            qInfo() << "Preparing kernel for starting:" << protocol;
-            hasAllKernelPrepared &= kernel->PrepareConfigurations();
-            if (!hasAllKernelPrepared)
+            for (const auto &[name, kernel] : kernels)
             {
-                qInfo() << "Plugin Kernel:" << protocol << "failed to initialize.";
-                break;
+                qInfo() << "Preparing kernel for starting:" << name;
+                results << prepare(kernel.get());
             }
         }
 
-        // Start the default kernel
-        if (hasAllKernelPrepared)
+        QStringList failedKernels;
+        auto it = kernels.cbegin();
+        for (const auto &[succeeded, elapsed] : results)
         {
-            auto defaultKernel = defaultKernelInfo.Create();
-            defaultKernel->SetProfileContent(fullProfile);
-            hasAllKernelPrepared &= defaultKernel->PrepareConfigurations();
-            d->kernels.push_back({ d->QV2RAYBASE_DEFAULT_KERNEL_PLACEHOLDER, std::move(defaultKernel) });
-            d->current = id;
+            const auto name = it->first == KernelManagerPrivate::QV2RAYBASE_DEFAULT_KERNEL_PLACEHOLDER ? defaultKernelInfo.Name : it->first;
+            timings << KernelTiming{ name, elapsed };
+            if (!succeeded)
+            {
+                qInfo() << "Kernel:" << name << "failed to initialize.";
+                failedKernels << name;
+            }
+            it++;
         }
 
-        if (!hasAllKernelPrepared)
+        if (!failedKernels.isEmpty())
+            return KernelManager::tr("Cannot prepare kernels: %1. Please check the profile and the error log.").arg(failedKernels.join(u", "_qs));
+
+        return std::nullopt;
+    }
+
+    std::optional<QString> KernelManager::StartConnection(const ProfileId &id, const ProfileContent &root)
+    {
+        Q_D(KernelManager);
+        p_CancelRestarts({});
+
+        // Make-before-break: keep the running kernels serving traffic until the new ones are prepared.
+        const auto seamless = Qv2rayBaseLibrary::GetConfig()->kernel_config.seamless_switching && !d->sessions.empty();
+        if (!seamless)
         {
             StopConnection();
-            return tr("Cannot start at least one kernel. Please check the profile and the error log.");
+            return p_StartSession(id, root, {});
+        }
+
+        // Only the first profile is replaced seamlessly, others are stopped.
+        while (d->sessions.size() > 1)
+            p_StopSession(d->sessions.back().id);
+        return p_StartSession(id, root, d->sessions.front().id);
+    }
+
+    void KernelManager::PrefetchConnection(const ProfileId &id, const ProfileContent &root)
+    {
+        Q_D(KernelManager);
+        if (d->prefetched && d->prefetched->id == id && d->prefetched->profile.toJson() == root.toJson())
+            return;
+
+        p_DiscardPrefetched();
+        if (IsConnected(id))
+            return;
+
+#if QT_CONFIG(concurrent)
+        const auto serial = d->prefetchSerial;
+        QtConcurrent::run(
+            [id, root, target = thread()]()
+            {
+                auto session = std::make_shared<KernelSession>();
+                session->id = id;
+                session->profile = root;
+
+                // This already runs on the thread pool, don't wait for other pool threads here.
+                if (const auto err = PrepareKernels(root, session->fullProfile, session->kernels, session->reservedPorts, session->timings, false); err)
+                {
+                    qInfo() << "Cannot prefetch" << id.toString() << ":" << *err;
+                    PortAllocator::ReleasePorts(session->reservedPorts);
+                    return std::shared_ptr<KernelSession>{};
+                }
+
+                // Kernels are created on this worker thread, hand them over to the thread which starts them.
+                for (const auto &[_, kernel] : session->kernels)
+                    kernel->moveToThread(target);
+                return session;
+            })
+            .then(this,
+                  [this, serial](std::shared_ptr<KernelSession> session)
+                  {
+                      Q_D(KernelManager);
+                      if (!session)
+                          return;
+
+                      // Another profile has been prefetched, or this one has been started in the meantime.
+                      if (serial != d->prefetchSerial || IsConnected(session->id))
+                          return PortAllocator::ReleasePorts(session->reservedPorts);
+                      d->prefetched = std::move(session);
+                  });
+#endif
+    }
+
+    void KernelManager::p_DiscardPrefetched()
+    {
+        Q_D(KernelManager);
+        // Results of a running prefetch are dropped as well.
+        d->prefetchSerial++;
+        if (!d->prefetched)
+            return;
+
+        PortAllocator::ReleasePorts(d->prefetched->reservedPorts);
+        d->prefetched.reset();
+    }
+
+    std::optional<QString> KernelManager::StartAdditionalConnection(const ProfileId &id, const ProfileContent &root)
+    {
+        Q_D(KernelManager);
+        p_CancelRestarts(id);
+        if (!IsConnected(id))
+            return p_StartSession(id, root, {});
+
+        if (Qv2rayBaseLibrary::GetConfig()->kernel_config.seamless_switching)
+            return p_StartSession(id, root, id);
+
+        // The restarted session keeps its place, the current connection stays current.
+        const auto position = SessionPosition(d->sessions, id);
+        p_StopSession(id);
+        return p_StartSession(id, root, {}, position);
+    }
+
+    std::optional<QString> KernelManager::p_StartSession(const ProfileId &id, const ProfileContent &root, const ProfileId &replaced, qsizetype position)
+    {
+        Q_D(KernelManager);
+        const auto seamless = !replaced.isNull();
+
+        KernelSession session;
+        ProfileContent fullProfile;
+        if (d->prefetched && d->prefetched->id == id && d->prefetched->profile.toJson() == root.toJson())
+        {
+            qInfo() << "Using the prefetched kernels of" << id.toString();
+            const auto prefetched = std::exchange(d->prefetched, nullptr);
+            fullProfile = prefetched->fullProfile;
+            session.kernels = std::move(prefetched->kernels);
+            session.reservedPorts = prefetched->reservedPorts;
+            session.timings = prefetched->timings;
+        }
+        else if (const auto err = PrepareKernels(root, fullProfile, session.kernels, session.reservedPorts, session.timings); err)
+        {
+            // Kernels which have not been started are simply destroyed, the running ones are left untouched.
+            PortAllocator::ReleasePorts(session.reservedPorts);
+            return err;
         }
 
-        for (auto &k : d->kernels)
+        // Start() stays on this thread, kernels usually spawn processes or timers owned by the kernel object.
+        const auto startKernel = [this](const QString &name, PluginKernel *kernel, KernelTiming &timing)
         {
-            qInfo() << "Starting kernel:" << k.first;
+            qInfo() << "Starting kernel:" << name;
 
             // We need to use old style runtime connection.
-            connect(k.second.get(), SIGNAL(OnCrashed(QString)), this, SLOT(OnKernelCrashed_p(QString)), Qt::QueuedConnection);
-            connect(k.second.get(), SIGNAL(OnLog(QString)), this, SLOT(OnKernelLog_p(QString)), Qt::QueuedConnection);
-            connect(k.second.get(), SIGNAL(OnStatsAvailable(StatisticsObject)), this, SLOT(OnKernelStatsDataRcvd_p(StatisticsObject)), Qt::QueuedConnection);
+            connect(kernel, SIGNAL(OnCrashed(QString)), this, SLOT(OnKernelCrashed_p(QString)), Qt::QueuedConnection);
+            connect(kernel, SIGNAL(OnLog(QString)), this, SLOT(OnKernelLog_p(QString)), Qt::QueuedConnection);
+            connect(kernel, SIGNAL(OnStatsAvailable(StatisticsObject)), this, SLOT(OnKernelStatsDataRcvd_p(StatisticsObject)), Qt::QueuedConnection);
+
+            QElapsedTimer timer;
+            timer.start();
+            kernel->Start();
+            timing.start = timer.elapsed();
+        };
+
+        // Kernel names are resolved once, not for every log message.
+        {
+            qsizetype padding = 0;
+            QList<std::pair<const QObject *, QString>> names;
+            for (const auto &[name, kernel] : session.kernels)
+            {
+                names.append({ kernel.get(), Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(kernel->GetKernelId()).Name });
+                padding = std::max(padding, names.last().second.length());
+            }
+            for (const auto &[kernel, name] : names)
+            {
+                d->kernelOwners.insert(kernel, id);
+                d->kernelLogPrefixes.insert(kernel, u"[%1] "_qs.arg(name, padding));
+            }
+        }
+
+        QElapsedTimer switchTimer;
+        if (seamless)
+        {
+            // Plugin kernels listen on ports unused by the old set, start them before stopping it.
+            auto timing = session.timings.begin();
+            for (const auto &[name, kernel] : session.kernels)
+                if (name != d->QV2RAYBASE_DEFAULT_KERNEL_PLACEHOLDER)
+                    startKernel(name, kernel.get(), *timing++);
+
+            switchTimer.start();
+            position = SessionPosition(d->sessions, replaced);
+            p_StopSession(replaced);
+        }
+
+        session.id = id;
+        session.serial = ++d->sessionSerial;
+        session.profile = root;
+        session.startedAt = QDateTime::currentMSecsSinceEpoch();
+        session.fullProfile = fullProfile;
+        session.inboundInfo = GetInboundInfo(fullProfile);
+        session.outboundInfo = GetOutboundInfo(fullProfile);
+        const auto where = position < 0 ? d->sessions.end() : std::next(d->sessions.begin(), std::min<qsizetype>(position, d->sessions.size()));
+        auto &s = *d->sessions.emplace(where, std::move(session));
+
+        {
+            auto timing = s.timings.begin();
+            for (const auto &[name, kernel] : s.kernels)
+            {
+                if (!seamless || name == d->QV2RAYBASE_DEFAULT_KERNEL_PLACEHOLDER)
+                    startKernel(name, kernel.get(), *timing);
+                timing++;
+            }
+        }
+
+        for (const auto &timing : s.timings)
+            qInfo() << "Kernel" << timing.name << "prepared in" << timing.prepare << "ms, started in" << timing.start << "ms.";
+
+        if (seamless)
+            qInfo() << "Switched to the new kernels in" << switchTimer.elapsed() << "ms.";
+
+        if (const auto interval = Qv2rayBaseLibrary::GetConfig()->kernel_config.resource_monitor_interval; interval > 0 && d->monitorTimerId == 0)
+            d->monitorTimerId = startTimer(interval * 1000);
 
-            k.second->Start();
+        p_UpdateStatsPoller();
+        p_WaitUntilReady(s);
+        return std::nullopt;
+    }
+
+    void KernelManager::p_WaitUntilReady(const KernelSession &session)
+    {
+        QList<KernelReadinessProbe::Endpoint> endpoints;
+        for (const auto &in : session.fullProfile.inbounds)
+        {
+            const auto &settings = in.inboundSettings;
+            if (settings.port.from <= 0)
+                continue;
+
+            // UDP-only inbounds, such as a dokodemo-door for DNS, never accept TCP connections.
+            if (const auto network = settings.protocolSettings.value(u"network"_qs).toString(); !network.isEmpty() && !network.contains(u"tcp"))
+                continue;
+
+            // Inbounds listening on every interface are reachable via loopback, hostnames are not resolved.
+            QHostAddress address;
+            if (settings.address.isEmpty() || settings.address == u"0.0.0.0" || settings.address == u"localhost")
+                address = QHostAddress::LocalHost;
+            else if (settings.address == u"::")
+                address = QHostAddress::LocalHostIPv6;
+            else if (!address.setAddress(settings.address))
+                continue;
+            endpoints << KernelReadinessProbe::Endpoint{ address, static_cast<quint16>(settings.port.from) };
         }
 
-        d->inboundInfo = GetInboundInfo(fullProfile);
-        d->outboundInfo = GetOutboundInfo(fullProfile);
+        const auto timeout = Qv2rayBaseLibrary::GetConfig()->kernel_config.readiness_timeout;
+        if (timeout <= 0 || endpoints.isEmpty())
+            return p_OnSessionReady(session.id, session.serial, std::nullopt);
+
+        // Connection attempts and backoff run on this thread, without blocking it.
+        const auto probe = new KernelReadinessProbe(endpoints, timeout * 1000LL, this);
+        connect(probe, &KernelReadinessProbe::OnFinished, this,
+                [this, probe, id = session.id, serial = session.serial](std::optional<qint64> readyTime)
+                {
+                    probe->deleteLater();
+                    p_OnSessionReady(id, serial, readyTime);
+                });
+        probe->Start();
+    }
+
+    void KernelManager::p_OnSessionReady(const ProfileId &id, quint64 serial, std::optional<qint64> readyTime)
+    {
+        Q_D(KernelManager);
+        const auto session = FindSession(d->sessions, id);
+        if (session == d->sessions.end() || session->serial != serial)
+            return; // Stopped or restarted while being probed.
+
+        if (readyTime)
+        {
+            session->readyTime = *readyTime;
+            qInfo() << "Connection" << id.toString() << "is ready in" << *readyTime << "ms.";
+        }
+        else if (Qv2rayBaseLibrary::GetConfig()->kernel_config.readiness_timeout > 0)
+        {
+            // Some inbounds never accept TCP connections, the kernels are still running.
+            qInfo() << "Inbounds of" << id.toString() << "are not accepting connections, reporting the connection anyway.";
+        }
 
+        session->connected = true;
         emit OnConnected(id);
-        Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<Connectivity>({ Connectivity::Connected, id, d->inboundInfo, d->outboundInfo });
+        Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<Connectivity>({ Connectivity::Connected, id, session->inboundInfo, session->outboundInfo });
+    }
+
+    std::optional<QString> KernelManager::ReloadConnection(const ProfileId &id, const ProfileContent &root)
+    {
+        Q_D(KernelManager);
+        const auto session = FindSession(d->sessions, id);
+        if (session == d->sessions.end())
+            return tr("Cannot reload a connection which is not running.");
+
+        const auto restart = [&](const QString &reason)
+        {
+            qInfo() << "Restarting connection" << id.toString() << "to apply changes:" << reason;
+            return StartAdditionalConnection(id, root);
+        };
+
+        const auto &current = session->profile;
+        if (root.defaultKernel != current.defaultKernel)
+            return restart(u"default kernel changed"_qs);
+
+        // Inbounds are bound by the kernels, they can't be changed on the fly.
+        if (root.inbounds.size() != current.inbounds.size())
+            return restart(u"inbounds changed"_qs);
+        for (qsizetype i = 0; i < root.inbounds.size(); i++)
+            if (root.inbounds[i].toJson() != current.inbounds[i].toJson())
+                return restart(u"inbounds changed"_qs);
+
+        // Outbounds handled by plugin kernels must stay the same, so that their kernels and ports can be kept.
+        const auto defaultKernelInfo = GetDefaultKernelInfo(root);
+        const auto isPluginOutbound = [&](const OutboundObject &o) { return !defaultKernelInfo.SupportedProtocols.contains(o.outboundSettings.protocol); };
+
+        QList<qsizetype> currentPluginOutbounds;
+        for (qsizetype i = 0; i < current.outbounds.size(); i++)
+            if (isPluginOutbound(current.outbounds[i]))
+                currentPluginOutbounds << i;
+
+        auto updated = root;
+        updated.inbounds = session->fullProfile.inbounds;
+        auto nextPluginOutbound = currentPluginOutbounds.cbegin();
+        for (auto &out : updated.outbounds)
+        {
+            if (!isPluginOutbound(out))
+                continue;
+            if (nextPluginOutbound == currentPluginOutbounds.cend() || current.outbounds[*nextPluginOutbound].toJson() != out.toJson())
+                return restart(u"plugin outbounds changed"_qs);
+            // Reuse the SOCKS outbound pointing to the running plugin kernel.
+            out = session->fullProfile.outbounds[*nextPluginOutbound++];
+        }
+        if (nextPluginOutbound != currentPluginOutbounds.cend())
+            return restart(u"plugin outbounds changed"_qs);
+
+        CarryOverNames(updated.outbounds, current.outbounds, session->fullProfile.outbounds);
+        CarryOverNames(updated.routing.rules, current.routing.rules, session->fullProfile.routing.rules);
+        AssignNames(updated);
+        if (updated.toJson() == session->fullProfile.toJson())
+            return std::nullopt;
+
+        const auto defaultKernel = session->kernels.back().second.get();
+        bool reloaded = false;
+        if (!CanReloadProfileContent(defaultKernel))
+            return restart(u"the kernel does not support reloading"_qs);
+        if (!QMetaObject::invokeMethod(defaultKernel, "ReloadProfileContent", Qt::DirectConnection, Q_RETURN_ARG(bool, reloaded), Q_ARG(QJsonObject, updated.toJson())) || !reloaded)
+            return restart(u"the kernel failed to reload"_qs);
+
+        qInfo() << "Reloaded connection" << id.toString() << "without restarting kernels.";
+        session->profile = root;
+        session->fullProfile = updated;
+        session->outboundInfo = GetOutboundInfo(updated);
         return std::nullopt;
     }
 
+    bool KernelManager::SupportsReload(const ProfileId &id) const
+    {
+        Q_D(const KernelManager);
+        const auto session = FindSession(d->sessions, id);
+        return session != d->sessions.end() && CanReloadProfileContent(session->kernels.back().second.get());
+    }
+
+    bool KernelManager::p_StopSession(const ProfileId &id)
+    {
+        Q_D(KernelManager);
+        const auto it = FindSession(d->sessions, id);
+        if (it == d->sessions.end())
+            return false;
+
+        Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<Connectivity>({ Connectivity::Disconnecting, id });
+
+        for (const auto &[kernel, kernelObject] : it->kernels)
+        {
+            qInfo() << "Stopping plugin kernel:" << kernel;
+            kernelObject->Stop();
+        }
+
+        // Logs of the stopped kernels still belong to this connection.
+        p_FlushKernelLogs();
+        for (const auto &[_, kernelObject] : it->kernels)
+        {
+            d->kernelOwners.remove(kernelObject.get());
+            d->kernelLogPrefixes.remove(kernelObject.get());
+            d->kernelProcesses.remove(kernelObject.get());
+        }
+
+        PortAllocator::ReleasePorts(it->reservedPorts);
+        const auto wasConnected = it->connected;
+        d->sessions.erase(it);
+
+        if (d->sessions.empty() && d->monitorTimerId != 0)
+        {
+            killTimer(d->monitorTimerId);
+            d->monitorTimerId = 0;
+        }
+        p_UpdateStatsPoller();
+
+        Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<Connectivity>({ Connectivity::Disconnected, id });
+
+        // Keep OnConnected and OnDisconnected paired, the start of this session has been aborted instead.
+        if (wasConnected)
+            emit OnDisconnected(id);
+        return true;
+    }
+
+    void KernelManager::StopConnection()
+    {
+        Q_D(KernelManager);
+        // An explicit stop cancels pending restarts.
+        p_CancelRestarts({});
+
+        if (d->sessions.empty())
+        {
+            qInfo() << "Cannot disconnect when there's nothing connected.";
+            return;
+        }
+
+        while (!d->sessions.empty())
+            p_StopSession(d->sessions.front().id);
+    }
+
+    void KernelManager::StopConnection(const ProfileId &id)
+    {
+        p_CancelRestarts(id);
+        if (!p_StopSession(id))
+            qInfo() << "Cannot disconnect" << id.toString() << ", it's not connected.";
+    }
+
+    void KernelManager::p_CancelRestarts(const ProfileId &id)
+    {
+        Q_D(KernelManager);
+        for (auto it = d->pendingRestarts.begin(); it != d->pendingRestarts.end();)
+        {
+            if (!id.isNull() && it->id != id)
+            {
+                it++;
+                continue;
+            }
+            killTimer(it.key());
+            it = d->pendingRestarts.erase(it);
+        }
+    }
+
     void KernelManager::OnKernelCrashed_p(const QString &msg)
     {
         Q_D(KernelManager);
-        StopConnection();
-        emit OnCrashed(d->current, msg);
+        const auto id = d->kernelOwners.value(sender());
+        const auto it = FindSession(d->sessions, id);
+
+        // The profile has been stopped already.
+        if (it == d->sessions.end())
+            return;
+
+        const auto profile = it->profile;
+        const auto position = SessionPosition(d->sessions, id);
+        const auto uptime = QDateTime::currentMSecsSinceEpoch() - it->startedAt;
+        auto crashState = it->crashState;
+        p_StopSession(id);
+
+        d->supervisorStatistics.crashes++;
+        constexpr std::array<qint64, 4> UptimeBuckets{ 10'000, 60'000, 600'000, 3'600'000 };
+        const auto bucket = std::upper_bound(UptimeBuckets.cbegin(), UptimeBuckets.cend(), uptime) - UptimeBuckets.cbegin();
+        d->supervisorStatistics.uptimeHistogram[bucket]++;
+
+        // Sessions which survived for a while start the backoff over.
+        if (uptime >= KERNEL_RESTART_STABLE_UPTIME)
+            crashState.consecutiveCrashes = 0;
+
+        if (!p_ScheduleRestart(id, profile, position, crashState, msg))
+            emit OnCrashed(id, msg);
+    }
+
+    bool KernelManager::p_ScheduleRestart(const ProfileId &id, const ProfileContent &profile, qsizetype position, KernelCrashState crashState, const QString &reason)
+    {
+        Q_D(KernelManager);
+        const auto &config = Qv2rayBaseLibrary::GetConfig()->kernel_config;
+        if (!config.auto_restart)
+            return false;
+
+        // Crash-loop breaker, crashes are counted for each profile on its own.
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+        crashState.crashTimes.removeIf([&](qint64 t) { return now - t > config.auto_restart_crash_window * 1000LL; });
+        crashState.crashTimes << now;
+        if (crashState.crashTimes.size() > config.auto_restart_max_crashes)
+        {
+            qInfo() << "Kernel of" << id.toString() << "crashed" << crashState.crashTimes.size() << "times within" << config.auto_restart_crash_window << "seconds, giving up.";
+            return false;
+        }
+
+        // Exponential backoff with jitter, so that several instances don't restart at the same time.
+        const auto exponent = std::min(crashState.consecutiveCrashes++, 5);
+        const auto backoff = std::min<qint64>(KERNEL_RESTART_BASE_DELAY << exponent, KERNEL_RESTART_MAX_DELAY);
+        const auto delay = backoff * QRandomGenerator::global()->bounded(80, 121) / 100;
+
+        qInfo() << "Kernel crashed:" << reason << ", restarting in" << delay << "ms.";
+        d->pendingRestarts.insert(startTimer(delay), { id, profile, position, crashState });
+        return true;
+    }
+
+    static qint64 GetKernelProcessId(PluginKernel *kernel)
+    {
+        // Kernels may report their process with an optional "qint64 GetProcessId()" invokable method.
+        if (kernel->metaObject()->indexOfMethod("GetProcessId()") >= 0)
+        {
+            qint64 pid = 0;
+            if (QMetaObject::invokeMethod(kernel, "GetProcessId", Qt::DirectConnection, Q_RETURN_ARG(qint64, pid)))
+                return pid;
+        }
+
+#if QT_CONFIG(process)
+        // Otherwise look for a running process owned by the kernel.
+        for (const auto process : kernel->findChildren<QProcess *>())
+            if (process->state() == QProcess::Running)
+                return process->processId();
+#endif
+        return 0;
+    }
+
+    void KernelManager::p_SampleKernelResources()
+    {
+        Q_D(KernelManager);
+        const auto &config = Qv2rayBaseLibrary::GetConfig()->kernel_config;
+        for (const auto &session : d->sessions)
+        {
+            for (const auto &[_, kernel] : session.kernels)
+            {
+                const auto pid = GetKernelProcessId(kernel.get());
+                const auto sample = ProcessSampler::Read(pid);
+                if (!sample)
+                    continue;
+
+                auto &state = d->kernelProcesses[kernel.get()];
+                const auto hasPrevious = state.usage.pid == pid;
+
+                state.usage.name = Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(kernel->GetKernelId()).Name;
+                state.usage.pid = pid;
+                state.usage.rss = sample->rss;
+                state.usage.cpu = hasPrevious ? ProcessSampler::CpuUsage(state.lastSample, *sample) : 0;
+                state.usage.threads = sample->threads;
+                state.usage.readBytes = sample->readBytes;
+                state.usage.writeBytes = sample->writeBytes;
+                state.lastSample = *sample;
+
+                // Alert once when crossing a threshold, again only after going back below it.
+                const auto exceeded = (config.resource_alert_rss > 0 && state.usage.rss > config.resource_alert_rss * 1024LL * 1024LL) ||
+                                      (config.resource_alert_cpu > 0 && state.usage.cpu > config.resource_alert_cpu);
+                if (exceeded && !state.alerted)
+                {
+                    qInfo() << "Kernel" << state.usage.name << "exceeded the resource threshold, RSS:" << state.usage.rss << "CPU:" << state.usage.cpu;
+                    emit OnKernelResourceAlert(session.id, state.usage);
+                }
+                state.alerted = exceeded;
+            }
+        }
+    }
+
+    const QList<KernelResourceUsage> KernelManager::GetKernelResourceUsage() const
+    {
+        Q_D(const KernelManager);
+        QList<KernelResourceUsage> result;
+        for (const auto &session : d->sessions)
+            for (const auto &[_, kernel] : session.kernels)
+                if (d->kernelProcesses.contains(kernel.get()))
+                    result << d->kernelProcesses[kernel.get()].usage;
+        return result;
+    }
+
+    KernelSupervisorStatistics KernelManager::GetSupervisorStatistics() const
+    {
+        Q_D(const KernelManager);
+        return d->supervisorStatistics;
     }
 
     void KernelManager::OnKernelLog_p(const QString &log)
     {
         Q_D(KernelManager);
-        if (d->logPadding <= 0)
-            for (const auto &[_, kernel] : d->kernels)
-                d->logPadding = std::max(d->logPadding, Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(kernel->GetKernelId()).Name.length());
+        const auto session = FindSession(d->sessions, d->kernelOwners.value(sender()));
+        if (session == d->sessions.end())
+            return;
 
-        const auto kernel = static_cast<PluginKernel *>(sender());
-        const auto name = kernel ? Qv2rayBaseLibrary::PluginAPIHost()->Kernel_GetInfo(kernel->GetKernelId()).Name : u"UNKNOWN"_qs;
+        const auto prefix = d->kernelLogPrefixes.value(sender(), u"[UNKNOWN] "_qs);
+        const auto parseAccessLog = Qv2rayBaseLibrary::GetConfig()->kernel_config.access_log_statistics;
 
-        for (const auto &line : SplitLines(log))
-            emit OnKernelLogAvailable(d->current, u"[%1] "_qs.arg(name, d->logPadding) + line.trimmed());
+        // Split on '\r' and '\n', skipping empty lines.
+        const QStringView view{ log };
+        qsizetype begin = 0;
+        for (qsizetype i = 0; i <= view.size(); i++)
+        {
+            if (i < view.size() && view[i] != u'\n' && view[i] != u'\r')
+                continue;
+
+            if (const auto line = view.sliced(begin, i - begin).trimmed(); !line.isEmpty())
+            {
+                if (parseAccessLog)
+                    d->accessLog.Add(line);
+
+                QString entry;
+                entry.reserve(prefix.size() + line.size());
+                entry.append(prefix).append(line);
+                session->logBuffer.Push(std::move(entry));
+            }
+            begin = i + 1;
+        }
+
+        // Lines are emitted in batches by the timer, which stops itself when there's nothing to send.
+        if (d->logTimerId == 0)
+            d->logTimerId = startTimer(KERNEL_LOG_FLUSH_INTERVAL);
     }
 
-    void KernelManager::StopConnection()
+    void KernelManager::timerEvent(QTimerEvent *event)
     {
         Q_D(KernelManager);
-        Q_ASSERT(d->kernels.empty() == d->current.isNull());
+        if (d->pendingRestarts.contains(event->timerId()))
+        {
+            killTimer(event->timerId());
+            const auto [id, profile, position, crashState] = d->pendingRestarts.take(event->timerId());
+            d->supervisorStatistics.restarts++;
+            // The crashed session has been stopped, unless it was started again in the meantime.
+            const auto err = IsConnected(id) ? StartAdditionalConnection(id, profile) : p_StartSession(id, profile, {}, position);
+            if (err)
+            {
+                if (!p_ScheduleRestart(id, profile, position, crashState, *err))
+                    emit OnCrashed(id, *err);
+            }
+            else if (const auto it = FindSession(d->sessions, id); it != d->sessions.end())
+            {
+                it->crashState = crashState;
+            }
+            return;
+        }
 
-        if (d->kernels.empty())
+        if (event->timerId() == d->monitorTimerId)
+            return p_SampleKernelResources();
+
+        if (event->timerId() == d->statsTimerId)
         {
-            qInfo() << "Cannot disconnect when there's nothing connected.";
+            // Counters are reset on every query, each response is the traffic since the previous one.
+            d->statsClient->QueryStats({}, true);
+            d->statsClient->GetSysStats();
             return;
         }
 
-        Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<Connectivity>({ Connectivity::Disconnecting, d->current });
+        if (event->timerId() != d->logTimerId)
+            return QObject::timerEvent(event);
 
-        for (const auto &[kernel, kernelObject] : d->kernels)
+        if (std::all_of(d->sessions.cbegin(), d->sessions.cend(), [](const KernelSession &s) { return s.logBuffer.IsEmpty(); }))
         {
-            qInfo() << "Stopping plugin kernel:" << kernel;
-            kernelObject->Stop();
+            killTimer(d->logTimerId);
+            d->logTimerId = 0;
+            return;
         }
 
-        d->logPadding = 0;
-        Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<Connectivity>({ Connectivity::Disconnected, d->current });
-        emit OnDisconnected(d->current);
+        p_FlushKernelLogs();
+    }
+
+    void KernelManager::p_FlushKernelLogs()
+    {
+        Q_D(KernelManager);
+        for (auto &session : d->sessions)
+        {
+            if (session.logBuffer.IsEmpty())
+                continue;
+
+            auto lines = session.logBuffer.TakeAll();
+            if (const auto dropped = session.logBuffer.TakeDropped(); dropped > 0)
+            {
+                d->droppedLogLines += dropped;
+                lines.prepend(u"[Qv2rayBase] %1 log lines were dropped."_qs.arg(dropped));
+            }
+            const auto batch = lines.join(u'\n');
+            if (d->logWriter)
+                d->logWriter->Append(batch);
+            emit OnKernelLogAvailable(session.id, batch);
+        }
+    }
+
+    quint64 KernelManager::DroppedKernelLogLines() const
+    {
+        Q_D(const KernelManager);
+        return d->droppedLogLines;
+    }
+
+    AccessLogStatistics KernelManager::GetAccessLogStatistics(int topK) const
+    {
+        Q_D(const KernelManager);
+        AccessLogStatistics result;
+        result.accepted = d->accessLog.Accepted();
+        result.rejected = d->accessLog.Rejected();
+        result.destinations = d->accessLog.TopDestinations(topK);
+        result.outbounds = d->accessLog.TopOutbounds(topK);
+        return result;
+    }
 
-        d->current.clear();
-        d->kernels.clear();
+    void KernelManager::ClearAccessLogStatistics()
+    {
+        Q_D(KernelManager);
+        d->accessLog.Clear();
     }
 
     void KernelManager::OnKernelStatsDataRcvd_p(const StatisticsObject &s)
     {
         Q_D(KernelManager);
-        emit OnStatsDataAvailable(d->current, s);
+        const auto owner = d->kernelOwners.value(sender());
+
+        // Traffic of the polled connection comes from the StatsService API, don't count it twice.
+        if (d->statsClient && d->statsServiceAvailable && owner == d->statsConnection)
+            return;
+        emit OnStatsDataAvailable(owner, s);
+    }
+
+    KernelTrafficStatistics KernelManager::GetKernelTrafficStatistics() const
+    {
+        Q_D(const KernelManager);
+        return d->trafficStatistics;
+    }
+
+    void KernelManager::p_UpdateStatsPoller()
+    {
+        Q_D(KernelManager);
+        const auto &config = Qv2rayBaseLibrary::GetConfig()->kernel_config;
+        const auto current = CurrentConnection();
+
+        if (current.isNull() || config.stats_api_port <= 0)
+        {
+            if (d->statsTimerId != 0)
+                killTimer(d->statsTimerId);
+            d->statsTimerId = 0;
+            d->statsClient.reset();
+            d->statsConnection = {};
+            d->statsServiceAvailable = false;
+            return;
+        }
+
+        if (d->statsConnection != current)
+            d->statsConnection = current, d->trafficStatistics = {}, d->statsServiceAvailable = false;
+
+        if (!d->statsClient)
+        {
+            d->statsClient = std::make_unique<StatsServiceClient>(u"127.0.0.1"_qs, config.stats_api_port);
+            connect(d->statsClient.get(), &StatsServiceClient::OnStatsReceived, this, &KernelManager::p_OnServiceStatsReceived);
+            connect(d->statsClient.get(), &StatsServiceClient::OnError, this,
+                    [d](const QString &method, const QString &error)
+                    {
+                        if (d->trafficStatistics.error != error)
+                            qInfo() << "StatsService:" << method << error;
+                        d->trafficStatistics.error = error;
+                        // Without the API, traffic of the connection is taken from the kernels.
+                        if (method == u"QueryStats")
+                            d->statsServiceAvailable = false;
+                    });
+            connect(d->statsClient.get(), &StatsServiceClient::OnSysStatsReceived, this,
+                    [d](const StatsServiceClient::SysStats &stats)
+                    {
+                        d->trafficStatistics.goroutines = stats.numGoroutine;
+                        d->trafficStatistics.memoryAlloc = stats.alloc;
+                        d->trafficStatistics.memorySys = stats.sys;
+                        d->trafficStatistics.numGC = stats.numGC;
+                        d->trafficStatistics.uptime = stats.uptime;
+                    });
+        }
+
+        if (d->statsTimerId == 0)
+            d->statsTimerId = startTimer(std::max(100, config.stats_api_interval));
+    }
+
+    void KernelManager::p_OnServiceStatsReceived(const QList<std::pair<QString, qint64>> &stats)
+    {
+        Q_D(KernelManager);
+        const auto session = FindSession(d->sessions, d->statsConnection);
+        if (session == d->sessions.end())
+            return;
+
+        d->statsServiceAvailable = true;
+        d->trafficStatistics.error.clear();
+
+        StatisticsObject delta;
+        for (const auto &[name, value] : stats)
+        {
+            // Counters are named like "outbound>>>proxy>>>traffic>>>uplink", user counters are ignored.
+            const auto parts = QStringView{ name }.split(u">>>");
+            if (parts.size() != 4 || parts[2] != u"traffic" || value <= 0)
+                continue;
+
+            const auto uplink = parts[3] == u"uplink";
+            const auto tag = parts[1].toString();
+            if (parts[0] == u"inbound")
+            {
+                auto &counter = d->trafficStatistics.inbounds[tag];
+                (uplink ? counter.first : counter.second) += value;
+            }
+            else if (parts[0] == u"outbound")
+            {
+                auto &counter = d->trafficStatistics.outbounds[tag];
+                (uplink ? counter.first : counter.second) += value;
+
+                const auto &outbounds = session->fullProfile.outbounds;
+                const auto out = std::find_if(outbounds.cbegin(), outbounds.cend(), [&](const OutboundObject &o) { return o.name == tag; });
+                if (out == outbounds.cend() || out->outboundSettings.protocol == u"blackhole")
+                    continue;
+
+                if (out->outboundSettings.protocol == u"freedom")
+                    (uplink ? delta.directUp : delta.directDown) += value;
+                else
+                    (uplink ? delta.proxyUp : delta.proxyDown) += value;
+            }
+        }
+        emit OnStatsDataAvailable(d->statsConnection, delta);
     }
+
 } // namespace Qv2rayBase::Profile
@@ -17,6 +17,7 @@
 #include "Qv2rayBase/Profile/ProfileManager.hpp"
 
 #include "Qv2rayBase/Common/HTTPRequestHelper.hpp"
+#include "Qv2rayBase/Common/Settings.hpp"
 #include "Qv2rayBase/Common/Utils.hpp"
 #include "Qv2rayBase/Interfaces/IStorageProvider.hpp"
 #include "Qv2rayBase/Plugin/LatencyTestHost.hpp"
@@ -40,6 +41,9 @@
 
 #define nothing
 
+const auto LATENCY_HISTORY_KEY = "latency_history";
+const auto TRAFFIC_HISTORY_KEY = "traffic_history";
+
 namespace Qv2rayBase::Profile
 {
     using namespace Qv2rayPlugin::Event;
@@ -53,6 +57,9 @@ namespace Qv2rayBase::Profile
 
         connect(Qv2rayBaseLibrary::LatencyTestHost(), &Qv2rayBase::Plugin::LatencyTestHost::OnLatencyTestCompleted, this, &ProfileManager::p_OnLatencyDataArrived);
         connect(Qv2rayBaseLibrary::KernelManager(), &Qv2rayBase::Profile::KernelManager::OnStatsDataAvailable, this, &ProfileManager::p_OnStatsDataArrived);
+        connect(Qv2rayBaseLibrary::KernelManager(), &Qv2rayBase::Profile::KernelManager::OnConnected, this, &ProfileManager::p_OnKernelConnected);
+        connect(Qv2rayBaseLibrary::KernelManager(), &Qv2rayBase::Profile::KernelManager::OnDisconnected, this, &ProfileManager::p_OnKernelDisconnected);
+        connect(Qv2rayBaseLibrary::KernelManager(), &Qv2rayBase::Profile::KernelManager::OnCrashed, this, &ProfileManager::p_OnKernelCrashed);
 
         d->connections = Qv2rayBaseLibrary::StorageProvider()->GetConnections();
         const auto _groups = Qv2rayBaseLibrary::StorageProvider()->GetGroups();
@@ -91,10 +98,29 @@ namespace Qv2rayBase::Profile
             else
             {
                 d->connectionRootCache[id] = Qv2rayBaseLibrary::StorageProvider()->GetConnectionContent(id);
+                d->connectionIndex.Update(id, conn, d->connectionRootCache[id]);
                 qDebug() << "Loaded connection id:" << id << "into cache.";
             }
         }
 
+        const auto latencyHistory = Qv2rayBaseLibrary::StorageProvider()->GetExtraSettings(LATENCY_HISTORY_KEY);
+        for (auto it = latencyHistory.constBegin(); it != latencyHistory.constEnd(); it++)
+        {
+            const ConnectionId id{ it.key() };
+            if (d->connections.contains(id))
+                d->latencyHistory.insert(id, LatencyHistory::Deserialize(QByteArray::fromBase64(it.value().toString().toLatin1())));
+        }
+
+        const auto trafficHistory = Qv2rayBaseLibrary::StorageProvider()->GetExtraSettings(TRAFFIC_HISTORY_KEY);
+        for (auto it = trafficHistory.constBegin(); it != trafficHistory.constEnd(); it++)
+        {
+            const ConnectionId id{ it.key() };
+            if (!d->connections.contains(id))
+                continue;
+            d->trafficHistory.insert(id, TrafficHistory::Deserialize(QByteArray::fromBase64(it.value().toString().toLatin1())));
+            d->storedTrafficHistory.insert(it.key(), it.value());
+        }
+
         // Force default group name.
         if (!d->groups.contains(DefaultGroupId))
         {
@@ -114,6 +140,30 @@ namespace Qv2rayBase::Profile
         Qv2rayBaseLibrary::StorageProvider()->StoreConnections(d->connections);
         Qv2rayBaseLibrary::StorageProvider()->StoreGroups(d->groups);
         Qv2rayBaseLibrary::StorageProvider()->StoreRoutings(d->routings);
+
+        if (d->latencyHistoryChanged)
+        {
+            QJsonObject latencyHistory;
+            for (auto it = d->latencyHistory.constKeyValueBegin(); it != d->latencyHistory.constKeyValueEnd(); it++)
+                latencyHistory.insert(it->first.toString(), QString::fromLatin1(it->second.Serialize().toBase64()));
+            Qv2rayBaseLibrary::StorageProvider()->StoreExtraSettings(LATENCY_HISTORY_KEY, latencyHistory);
+            d->latencyHistoryChanged = false;
+        }
+
+        if (!d->dirtyTrafficHistory.isEmpty())
+        {
+            for (const auto &id : qAsConst(d->dirtyTrafficHistory))
+            {
+                const auto it = d->trafficHistory.constFind(id);
+                if (it == d->trafficHistory.constEnd())
+                    d->storedTrafficHistory.remove(id.toString());
+                else
+                    d->storedTrafficHistory.insert(id.toString(), QString::fromLatin1(it->Serialize().toBase64()));
+            }
+            Qv2rayBaseLibrary::StorageProvider()->StoreExtraSettings(TRAFFIC_HISTORY_KEY, d->storedTrafficHistory);
+            d->dirtyTrafficHistory.clear();
+        }
+
         Qv2rayBaseLibrary::StorageProvider()->EnsureSaved();
     }
 
@@ -140,6 +190,22 @@ namespace Qv2rayBase::Profile
         Qv2rayBaseLibrary::LatencyTestHost()->TestLatency(id, engine);
     }
 
+    LatencyStatistics ProfileManager::GetLatencyStatistics(const ConnectionId &id) const
+    {
+        Q_D(const ProfileManager);
+        const auto it = d->latencyHistory.constFind(id);
+        if (it == d->latencyHistory.constEnd())
+            return {};
+
+        LatencyStatistics result;
+        result.samples = it->Size();
+        result.failed = it->FailedCount();
+        result.p50 = it->Percentile(50);
+        result.p95 = it->Percentile(95);
+        result.jitter = it->Jitter();
+        return result;
+    }
+
     void ProfileManager::ClearGroupUsage(const GroupId &id)
     {
         Q_D(ProfileManager);
@@ -153,9 +219,30 @@ namespace Qv2rayBase::Profile
         Q_D(ProfileManager);
         CheckValidId(id.connectionId, nothing);
         d->connections[id.connectionId].statistics.clear();
+        if (d->trafficHistory.remove(id.connectionId))
+            d->dirtyTrafficHistory.insert(id.connectionId);
+        d->pendingStatsEvents.remove(id.connectionId);
         Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<ConnectionStats>({ id.connectionId, {} });
+
+        // A slow plugin may hold the reset back, it's delivered on a later tick.
+        if (d->statsEventTimerId == 0)
+            d->statsEventTimerId = startTimer(std::max(100, Qv2rayBaseLibrary::GetConfig()->plugin_config.stats_event_interval));
         return;
     }
+
+    QList<StatisticsObject> ProfileManager::GetTrafficHistory(const ConnectionId &id, TrafficHistoryResolution resolution) const
+    {
+        Q_D(const ProfileManager);
+        return d->trafficHistory.value(id).History(resolution, QDateTime::currentMSecsSinceEpoch());
+    }
+
+    StatisticsObject ProfileManager::GetTrafficRate(const ConnectionId &id) const
+    {
+        Q_D(const ProfileManager);
+        const auto it = d->trafficHistory.constFind(id);
+        return it == d->trafficHistory.constEnd() ? StatisticsObject{} : it->Rate(QDateTime::currentMSecsSinceEpoch());
+    }
+
     const QList<GroupId> ProfileManager::GetGroups(const ConnectionId &connId) const
     {
         Q_D(const ProfileManager);
@@ -181,6 +268,7 @@ namespace Qv2rayBase::Profile
         emit OnConnectionRenamed(id, d->connections[id].name, newName);
         Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<ConnectionEntry>({ ConnectionEntry::Renamed, NullGroupId, id, d->connections[id].name });
         d->connections[id].name = newName;
+        d->connectionIndex.Update(id, d->connections[id], d->connectionRootCache[id]);
         SaveConnectionConfig();
     }
 
@@ -208,6 +296,10 @@ namespace Qv2rayBase::Profile
         {
             qInfo() << "Fully removing a connection from cache.";
             d->connectionRootCache.remove(id);
+            d->connectionIndex.Remove(id);
+            d->latencyHistoryChanged |= d->latencyHistory.remove(id);
+            if (d->trafficHistory.remove(id))
+                d->dirtyTrafficHistory.insert(id);
             Qv2rayBaseLibrary::StorageProvider()->DeleteConnection(id);
             d->connections.remove(id);
         }
@@ -296,10 +388,9 @@ namespace Qv2rayBase::Profile
         return true;
     }
 
-    bool ProfileManager::StartConnection(const ProfileId &identifier)
+    ProfileContent ProfileManager::p_GetEffectiveProfile(const ProfileId &identifier)
     {
         Q_D(ProfileManager);
-        CheckValidId(identifier, false);
         ProfileContent root = GetConnection(identifier.connectionId);
 
         const auto groupRouting = GetRouting(d->groups[identifier.groupId].route_id);
@@ -335,7 +426,26 @@ namespace Qv2rayBase::Profile
             }
         }
 
-        const auto newProfile = Qv2rayBaseLibrary::PluginAPIHost()->PreprocessProfile(root);
+        return Qv2rayBaseLibrary::PluginAPIHost()->PreprocessProfile(root);
+    }
+
+    void ProfileManager::p_ReloadRunningConnections(const std::function<bool(const ProfileId &)> &predicate)
+    {
+        for (const auto &id : Qv2rayBaseLibrary::KernelManager()->ActiveConnections())
+        {
+            // Without kernel support, changes are applied when the connection is started again.
+            if (!predicate(id) || !Qv2rayBaseLibrary::KernelManager()->SupportsReload(id))
+                continue;
+            if (const auto errMsg = Qv2rayBaseLibrary::KernelManager()->ReloadConnection(id, p_GetEffectiveProfile(id)); errMsg)
+                Qv2rayBaseLibrary::Warn(tr("Failed to apply changes to the running connection"), *errMsg);
+        }
+    }
+
+    bool ProfileManager::StartConnection(const ProfileId &identifier)
+    {
+        Q_D(ProfileManager);
+        CheckValidId(identifier, false);
+        const auto newProfile = p_GetEffectiveProfile(identifier);
 
         auto errMsg = Qv2rayBaseLibrary::KernelManager()->StartConnection(identifier, newProfile);
         if (errMsg)
@@ -364,6 +474,159 @@ namespace Qv2rayBase::Profile
         Q_D(ProfileManager);
         CheckValidId(id, nothing);
         d->connections[id].latency = data.avg;
+        if (data.avg != LATENCY_TEST_VALUE_NODATA)
+        {
+            d->latencyHistory[id].Push(LatencyHistory::IsSuccessful(data.avg) ? static_cast<int>(data.avg) : -1);
+            d->latencyHistoryChanged = true;
+        }
+
+        // Probes for the active connection, sent by the failover timer.
+        const auto current = Qv2rayBaseLibrary::KernelManager()->CurrentConnection();
+        if (d->failoverTimerId == 0 || current.connectionId != id)
+            return;
+
+        if (LatencyHistory::IsSuccessful(data.avg))
+        {
+            d->failoverFailedProbes = 0;
+            return;
+        }
+
+        d->failoverFailedProbes++;
+        qInfo() << "Failover probe failed for" << id << "count:" << d->failoverFailedProbes;
+        if (d->failoverFailedProbes >= std::max(1, Qv2rayBaseLibrary::GetConfig()->failover_config.failed_probes))
+            p_Failover(current);
+    }
+
+    void ProfileManager::p_OnKernelConnected(const ProfileId &id)
+    {
+        Q_D(ProfileManager);
+        // Failover only watches the current connection, not the additional ones.
+        if (id != Qv2rayBaseLibrary::KernelManager()->CurrentConnection())
+            return;
+
+        d->failoverConnection = id;
+        if (Qv2rayBaseLibrary::GetConfig()->kernel_config.prefetch_next_connection)
+            p_PrefetchNextConnection(id);
+
+        const auto &config = Qv2rayBaseLibrary::GetConfig()->failover_config;
+        if (d->failoverTimerId != 0)
+            killTimer(d->failoverTimerId), d->failoverTimerId = 0;
+
+        d->failoverFailedProbes = 0;
+        if (!config.enabled)
+            return;
+
+        // Probe often enough to collect all failed probes within the detection window.
+        const auto interval = std::max(1000, config.detection_window * 1000 / std::max(1, config.failed_probes));
+        d->failoverTimerId = startTimer(interval);
+    }
+
+    void ProfileManager::p_OnKernelDisconnected(const ProfileId &)
+    {
+        Q_D(ProfileManager);
+        if (!Qv2rayBaseLibrary::KernelManager()->CurrentConnection().isNull())
+            return;
+
+        if (d->failoverTimerId != 0)
+            killTimer(d->failoverTimerId), d->failoverTimerId = 0;
+    }
+
+    void ProfileManager::p_OnKernelCrashed(const ProfileId &id, const QString &)
+    {
+        Q_D(ProfileManager);
+        if (!Qv2rayBaseLibrary::GetConfig()->failover_config.enabled)
+            return;
+
+        // The crashed session has been removed already, decide by its id: only the current connection fails over.
+        // An additional connection which became current later is failed over when nothing else is running.
+        if (id != d->failoverConnection && !Qv2rayBaseLibrary::KernelManager()->CurrentConnection().isNull())
+            return;
+        p_Failover(id);
+    }
+
+    void ProfileManager::timerEvent(QTimerEvent *event)
+    {
+        Q_D(ProfileManager);
+        if (event->timerId() == d->statsEventTimerId)
+            return p_SendPendingStatsEvents();
+
+        if (event->timerId() != d->failoverTimerId)
+            return QObject::timerEvent(event);
+
+        const auto current = Qv2rayBaseLibrary::KernelManager()->CurrentConnection();
+        if (current.isNull())
+            return;
+
+        auto engine = LatencyTestEngineId{ Qv2rayBaseLibrary::GetConfig()->failover_config.latency_test_engine };
+        if (engine.isNull())
+        {
+            const auto engines = Qv2rayBaseLibrary::PluginAPIHost()->Latency_GetAllEngines();
+            if (engines.isEmpty())
+                return;
+            engine = engines.first().Id;
+        }
+        Qv2rayBaseLibrary::LatencyTestHost()->TestLatency(current.connectionId, engine);
+    }
+
+    void ProfileManager::p_Failover(const ProfileId &failedId)
+    {
+        Q_D(ProfileManager);
+        CheckValidId(failedId, nothing);
+        d->failoverFailedProbes = 0;
+
+        // Mark the connection as failed, so that it won't be selected again until a new latency test succeeds.
+        d->connections[failedId.connectionId].latency = LATENCY_TEST_VALUE_ERROR;
+
+        const auto [bestId, bestLatency] = p_FindBestConnection(failedId.groupId, failedId.connectionId);
+        if (bestId.isNull())
+        {
+            qInfo() << "Failover: no healthy connection found in group" << failedId.groupId;
+            return;
+        }
+
+        qInfo() << "Failover: switching from" << failedId.connectionId << "to" << bestId << "with latency" << bestLatency;
+        StartConnection({ bestId, failedId.groupId });
+    }
+
+    std::pair<ConnectionId, int> ProfileManager::p_FindBestConnection(const GroupId &group, const ConnectionId &excluded)
+    {
+        Q_D(ProfileManager);
+        // Rank by tail latency when there's a history, otherwise by the last result.
+        ConnectionId bestId;
+        int bestLatency = LATENCY_TEST_VALUE_ERROR;
+        for (const auto &conn : d->groups[group].connections)
+        {
+            const auto lastLatency = d->connections[conn].latency;
+            // Untested (NODATA) and failed connections are no candidates, 0 ms is a valid result.
+            if (conn == excluded || !LatencyHistory::IsSuccessful(lastLatency))
+                continue;
+
+            const auto history = d->latencyHistory.value(conn);
+            const auto latency = history.Size() > history.FailedCount() ? history.Percentile(95) : lastLatency;
+            if (latency < bestLatency)
+                bestId = conn, bestLatency = latency;
+        }
+        return { bestId, bestLatency };
+    }
+
+    void ProfileManager::p_PrefetchNextConnection(const ProfileId &current)
+    {
+        Q_D(ProfileManager);
+        // The connection failover would pick, otherwise the most recently used one in the same group.
+        auto [next, _] = p_FindBestConnection(current.groupId, current.connectionId);
+        if (next.isNull())
+        {
+            for (const auto &conn : d->groups[current.groupId].connections)
+                if (conn != current.connectionId && (next.isNull() || d->connections[conn].last_connected > d->connections[next].last_connected))
+                    next = conn;
+        }
+
+        if (next.isNull())
+            return;
+
+        qInfo() << "Prefetching the next connection:" << next;
+        const ProfileId nextId{ next, current.groupId };
+        Qv2rayBaseLibrary::KernelManager()->PrefetchConnection(nextId, p_GetEffectiveProfile(nextId));
     }
 
     void ProfileManager::UpdateConnection(const ConnectionId &id, const ProfileContent &root)
@@ -371,9 +634,11 @@ namespace Qv2rayBase::Profile
         Q_D(ProfileManager);
         CheckValidId(id, nothing);
         d->connectionRootCache[id] = root;
+        d->connectionIndex.Update(id, d->connections[id], root);
         Qv2rayBaseLibrary::StorageProvider()->StoreConnection(id, root);
         emit OnConnectionModified(id);
         Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<ConnectionEntry>({ ConnectionEntry::Edited, NullGroupId, id, d->connections[id].name });
+        p_ReloadRunningConnections([&](const ProfileId &pid) { return pid.connectionId == id; });
     }
 
     const GroupId ProfileManager::CreateGroup(const QString &displayName)
@@ -413,6 +678,9 @@ namespace Qv2rayBase::Profile
     {
         Q_D(ProfileManager);
         d->routings.insert(id, o);
+
+        // Every connection may fall back to the global routing, reload them all in that case.
+        p_ReloadRunningConnections([&](const ProfileId &pid) { return id == DefaultRoutingId || d->groups.value(pid.groupId).route_id == id; });
     }
 
     bool ProfileManager::RenameGroup(const GroupId &id, const QString &newName)
@@ -763,21 +1031,47 @@ namespace Qv2rayBase::Profile
         if (id.isNull())
             return;
 
+        // A late sample of a connection which has been removed meanwhile.
         const auto &cid = id.connectionId;
+        if (!d->connections.contains(cid))
+            return;
+
         d->connections[cid].statistics.directUp += speed.directUp;
         d->connections[cid].statistics.directDown += speed.directDown;
         d->connections[cid].statistics.proxyUp += speed.proxyUp;
         d->connections[cid].statistics.proxyDown += speed.proxyDown;
+        d->trafficHistory[cid].Append(speed, QDateTime::currentMSecsSinceEpoch());
+        d->dirtyTrafficHistory.insert(cid);
 
-        Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<ConnectionStats>({ cid, d->connections[cid].statistics });
+        // Plugins receive the accumulated statistics on the next tick of the event timer.
+        d->pendingStatsEvents.insert(cid);
+        if (d->statsEventTimerId == 0)
+            d->statsEventTimerId = startTimer(std::max(100, Qv2rayBaseLibrary::GetConfig()->plugin_config.stats_event_interval));
     }
 
-    const ProfileId ProfileManager::CreateConnection(const ProfileContent &root, const QString &name, const GroupId &groupId)
+    void ProfileManager::p_SendPendingStatsEvents()
     {
-        ProfileContent newroot = root;
-
         Q_D(ProfileManager);
-        qInfo() << "Creating new connection:" << name;
+        if (d->pendingStatsEvents.isEmpty())
+        {
+            // Nothing happened during the last interval, stop waking up once slow plugins have caught up as well.
+            if (!Qv2rayBaseLibrary::PluginAPIHost()->Event_SendPendingStats())
+            {
+                killTimer(d->statsEventTimerId);
+                d->statsEventTimerId = 0;
+            }
+            return;
+        }
+
+        const auto pending = std::exchange(d->pendingStatsEvents, {});
+        for (const auto &cid : pending)
+            if (d->connections.contains(cid))
+                Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<ConnectionStats>({ cid, d->connections[cid].statistics });
+    }
+
+    static ProfileContent AssignObjectNames(const ProfileContent &root, const QString &name)
+    {
+        ProfileContent newroot = root;
 
         for (auto i = 0; i < newroot.inbounds.size(); i++)
             if (newroot.inbounds.at(i).name.isEmpty())
@@ -787,23 +1081,148 @@ namespace Qv2rayBase::Profile
             if (newroot.outbounds.at(i).name.isEmpty())
                 newroot.outbounds[i].name = name + u"-outbound-"_qs + QString::number(i + 1);
 
+        return newroot;
+    }
+
+    const ProfileId ProfileManager::CreateConnection(const ProfileContent &root, const QString &name, const GroupId &groupId)
+    {
+        Q_D(ProfileManager);
+        qInfo() << "Creating new connection:" << name;
+
+        const auto newroot = AssignObjectNames(root, name);
+
         ConnectionId newId(GenerateRandomString());
         d->groups[groupId].connections << newId;
         d->connections[newId].created = system_clock::now();
         d->connections[newId].name = name;
         d->connections[newId]._group_ref = 1;
         d->connectionRootCache[newId] = newroot;
+        d->connectionIndex.Update(newId, d->connections[newId], newroot);
         Qv2rayBaseLibrary::StorageProvider()->StoreConnection(newId, newroot);
         emit OnConnectionCreated({ newId, groupId }, name);
         Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<ConnectionEntry>({ ConnectionEntry::Created, groupId, newId, name });
         return { newId, groupId };
     }
 
+    std::pair<QList<ProfileId>, QMap<int, QString>> ProfileManager::ImportLinks(const QStringList &_links, const GroupId &groupId)
+    {
+        Q_D(ProfileManager);
+        using DecodeResult = std::optional<std::pair<QString, ProfileContent>>;
+
+        QMap<int, QString> errors;
+        if (!IsValidId(groupId))
+        {
+            for (auto i = 0; i < _links.size(); i++)
+                errors.insert(i, tr("Invalid group"));
+            return { {}, errors };
+        }
+
+        // Errors refer to positions in the input, empty lines are skipped.
+        QStringList links;
+        QList<int> positions;
+        links.reserve(_links.size());
+        positions.reserve(_links.size());
+        for (auto i = 0; i < _links.size(); i++)
+            if (const auto trimmed = _links.at(i).trimmed(); !trimmed.isEmpty())
+                links << trimmed, positions << i;
+
+        // Step 1: Decode all links, outbound handlers only parse strings so this can be done in parallel.
+        QList<DecodeResult> decoded;
+        decoded.reserve(links.size());
+#if QT_CONFIG(concurrent)
+        {
+            const auto threads = std::max(1, QThread::idealThreadCount());
+            const auto chunkSize = std::max<qsizetype>(1, (links.size() + threads - 1) / threads);
+            QList<QFuture<QList<DecodeResult>>> futures;
+            for (qsizetype i = 0; i < links.size(); i += chunkSize)
+            {
+                futures << QtConcurrent::run(
+                    [chunk = links.mid(i, chunkSize)]()
+                    {
+                        QList<DecodeResult> result;
+                        result.reserve(chunk.size());
+                        for (const auto &link : chunk)
+                            result << ConvertConfigFromString(link);
+                        return result;
+                    });
+            }
+            for (auto &future : futures)
+                decoded << future.result();
+        }
+#else
+        for (const auto &link : links)
+            decoded << ConvertConfigFromString(link);
+#endif
+
+        // Step 2: Deduplicate by endpoint, against the group and the links themselves.
+        QSet<IOBoundData> endpoints;
+        for (const auto &conn : d->groups[groupId].connections)
+            if (const auto &outbounds = d->connectionRootCache[conn].outbounds; !outbounds.isEmpty())
+                endpoints << GetOutboundInfo(outbounds.first());
+
+        // Step 3: Create all connections, then store them in one go.
+        QList<ProfileId> newConnections;
+        QHash<ConnectionId, ProfileContent> newContents;
+        const auto now = system_clock::now();
+        for (auto i = 0; i < links.size(); i++)
+        {
+            const auto &result = decoded.at(i);
+            if (!result || result->second.outbounds.isEmpty())
+            {
+                errors.insert(positions.at(i), tr("Cannot decode share link"));
+                continue;
+            }
+
+            const auto endpoint = GetOutboundInfo(result->second.outbounds.first());
+            if (endpoints.contains(endpoint))
+            {
+                errors.insert(positions.at(i), tr("A connection with the same endpoint already exists"));
+                continue;
+            }
+            endpoints << endpoint;
+
+            const auto &name = result->first;
+            const auto newroot = AssignObjectNames(result->second, name);
+
+            ConnectionId newId(GenerateRandomString());
+            d->groups[groupId].connections << newId;
+            auto &connection = d->connections[newId];
+            connection.created = now;
+            connection.name = name;
+            connection._group_ref = 1;
+            d->connectionRootCache[newId] = newroot;
+            d->connectionIndex.Update(newId, connection, newroot);
+
+            newContents.insert(newId, newroot);
+            newConnections << ProfileId{ newId, groupId };
+        }
+
+        qInfo() << "Imported" << newConnections.size() << "connections from" << links.size() << "links.";
+        Qv2rayBaseLibrary::StorageProvider()->StoreConnectionContents(newContents);
+        SaveConnectionConfig();
+
+        for (const auto &id : newConnections)
+        {
+            const auto &name = d->connections[id.connectionId].name;
+            emit OnConnectionCreated(id, name);
+            Qv2rayBaseLibrary::PluginAPIHost()->Event_Send<ConnectionEntry>({ ConnectionEntry::Created, groupId, id.connectionId, name });
+        }
+
+        return { newConnections, errors };
+    }
+
     void ProfileManager::SetConnectionTags(const ConnectionId &id, const QStringList &tags)
     {
         Q_D(ProfileManager);
         CheckValidId(id, nothing);
         d->connections[id].tags = { tags.begin(), tags.end() };
+        d->connectionIndex.Update(id, d->connections[id], d->connectionRootCache[id]);
+    }
+
+    const QList<ConnectionId> ProfileManager::QueryConnections(const QString &query) const
+    {
+        Q_D(const ProfileManager);
+        return d->connectionIndex.Query(query, d->connections);
     }
 
     const QList<ConnectionId> ProfileManager::GetConnections() const
@@ -0,0 +1,131 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/private/Common/PortAllocator_p.hpp"
+
+#include <QMutex>
+
+#ifndef QV2RAYBASE_NO_LIBUV
+#include <uvw.hpp>
+#else
+#include <QTcpServer>
+#endif
+
+namespace Qv2rayBase::_private
+{
+    static QMutex reservedPortsMutex;
+    static QSet<int> reservedPorts;
+
+    QList<int> PortAllocator::ProbePorts(const QList<int> &candidates)
+    {
+        QList<int> available;
+#ifndef QV2RAYBASE_NO_LIBUV
+        // Bind and listen on every candidate in the same loop, libuv reports failures synchronously.
+        const auto loop = uvw::Loop::create();
+        std::vector<std::shared_ptr<uvw::TCPHandle>> handles;
+        std::vector<char> occupied(candidates.size(), false);
+        handles.reserve(candidates.size());
+        for (auto i = 0; i < candidates.size(); i++)
+        {
+            auto handle = loop->resource<uvw::TCPHandle>();
+            handle->on<uvw::ErrorEvent>([&occupied, i](const uvw::ErrorEvent &, uvw::TCPHandle &) { occupied[i] = true; });
+            handle->bind("127.0.0.1", candidates[i]);
+            if (!occupied[i])
+                handle->listen();
+            handles.push_back(handle);
+        }
+
+        for (const auto &handle : handles)
+            handle->close();
+        loop->run();
+        loop->close();
+
+        for (auto i = 0; i < candidates.size(); i++)
+            if (!occupied[i])
+                available << candidates[i];
+#else
+        for (const auto port : candidates)
+        {
+            QTcpServer server;
+            if (server.listen(QHostAddress::LocalHost, port))
+                available << port;
+        }
+#endif
+        return available;
+    }
+
+    QList<int> PortAllocator::FindAvailablePorts(int base, int count, const QSet<int> &excluded)
+    {
+        QList<int> result;
+        auto port = std::max(base, 1);
+        while (result.size() < count && port <= 65535)
+        {
+            // Probe a few more ports than needed, some of them might be occupied.
+            QList<int> candidates;
+            {
+                QMutexLocker locker{ &reservedPortsMutex };
+                for (; candidates.size() < (count - result.size()) * 2 && port <= 65535; port++)
+                    if (!excluded.contains(port) && !reservedPorts.contains(port))
+                        candidates << port;
+            }
+
+            for (const auto p : ProbePorts(candidates))
+                if (result.size() < count)
+                    result << p;
+        }
+        return result;
+    }
+
+    QList<int> PortAllocator::ReservePorts(int base, int count, const QSet<int> &excluded)
+    {
+        QList<int> result;
+        auto skipped = excluded;
+        while (result.size() < count)
+        {
+            const auto ports = FindAvailablePorts(base, count - result.size(), skipped);
+            if (ports.isEmpty())
+                break;
+
+            QMutexLocker locker{ &reservedPortsMutex };
+            for (const auto port : ports)
+            {
+                // Another caller may have reserved it while we were probing, look for a replacement after it.
+                if (!reservedPorts.contains(port))
+                    reservedPorts << port, result << port;
+                skipped << port;
+            }
+            base = ports.last() + 1;
+        }
+        return result;
+    }
+
+    QSet<int> PortAllocator::ClaimPorts(const QSet<int> &ports)
+    {
+        QSet<int> result;
+        QMutexLocker locker{ &reservedPortsMutex };
+        for (const auto port : ports)
+            if (port > 0 && !reservedPorts.contains(port))
+                reservedPorts << port, result << port;
+        return result;
+    }
+
+    void PortAllocator::ReleasePorts(const QSet<int> &ports)
+    {
+        QMutexLocker locker{ &reservedPortsMutex };
+        reservedPorts -= ports;
+    }
+} // namespace Qv2rayBase::_private
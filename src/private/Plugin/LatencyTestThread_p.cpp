@@ -17,9 +17,13 @@
 #include "Qv2rayBase/private/Plugin/LatencyTestThread_p.hpp"
 
 #include "Qv2rayBase/Common/ProfileHelpers.hpp"
+#include "Qv2rayBase/Common/Settings.hpp"
 #include "Qv2rayBase/Plugin/LatencyTestHost.hpp"
 #include "Qv2rayBase/Plugin/PluginAPIHost.hpp"
 #include "Qv2rayBase/Qv2rayBaseLibrary.hpp"
+#include "Qv2rayBase/private/Plugin/TcpLatencyTest_p.hpp"
+
+#include <algorithm>
 
 #ifndef QV2RAYBASE_NO_LIBUV
 #include <uvw.hpp>
@@ -27,100 +31,184 @@
 
 namespace Qv2rayBase::Plugin
 {
+    static Qv2rayPlugin::Latency::LatencyTestResponse EngineUnavailableResponse(const Qv2rayPlugin::Latency::LatencyTestRequest &req)
+    {
+        Qv2rayPlugin::Latency::LatencyTestResponse response;
+        response.engine = req.engine;
+        response.total = response.failed = 1;
+        response.avg = response.min = response.max = LATENCY_TEST_VALUE_ERROR;
+        response.error = QObject::tr("Latency test engine %1 is not available.").arg(req.engine.toString());
+        return response;
+    }
+
     LatencyTestThread::LatencyTestThread(QObject *parent) : QThread(parent)
     {
+        syncPool.setObjectName(u"LatencyTestPool"_qs);
     }
 
     void LatencyTestThread::stopLatencyTest()
     {
+        // Tests which have not been started are dropped, the running ones are waited for in run().
+        syncPool.clear();
+
+        std::unique_lock<std::mutex> lockGuard{ m };
         isStop = true;
+#ifndef QV2RAYBASE_NO_LIBUV
+        if (wakeup)
+            wakeup->send();
+#else
+        wakeup.notify_one();
+#endif
     }
 
     void LatencyTestThread::pushRequest(const ConnectionId &id, const LatencyTestEngineId &engine)
     {
         if (isStop)
             return;
-        std::unique_lock<std::mutex> lockGuard{ m };
         const auto &[protocol, host, port] = GetOutboundInfo(GetOutbound(id, 0));
-        requests.emplace_back(Qv2rayPlugin::Latency::LatencyTestRequest{ engine, id, host, port.from });
+        Qv2rayPlugin::Latency::LatencyTestRequest request{ engine, id, host, port.from };
+
+        std::unique_lock<std::mutex> lockGuard{ m };
+        requests.push_back(std::move(request));
+
+        // uv_async_send is thread-safe, several sends before the loop wakes up are coalesced.
+#ifndef QV2RAYBASE_NO_LIBUV
+        if (wakeup)
+            wakeup->send();
+#else
+        wakeup.notify_one();
+#endif
     }
 
     void LatencyTestThread::run()
     {
+        const auto host = qobject_cast<Qv2rayBase::Plugin::LatencyTestHost *>(parent());
+        syncPool.setMaxThreadCount(std::max(1, Qv2rayBaseLibrary::GetConfig()->plugin_config.latency_test_parallelism));
 #ifndef QV2RAYBASE_NO_LIBUV
         loop = uvw::Loop::create();
-        stopTimer = loop->resource<uvw::TimerHandle>();
-        stopTimer->on<uvw::TimerEvent>([this](auto &, auto &handle) { doTest(qobject_cast<Qv2rayBase::Plugin::LatencyTestHost *>(parent()), handle); });
-        stopTimer->start(uvw::TimerHandle::Time{ 500 }, uvw::TimerHandle::Time{ 500 });
+        const auto handle = loop->resource<uvw::AsyncHandle>();
+        handle->on<uvw::AsyncEvent>([this, host](const uvw::AsyncEvent &, uvw::AsyncHandle &) { doTest(host); });
+        {
+            std::unique_lock<std::mutex> lockGuard{ m };
+            wakeup = handle;
+        }
+
+        // Requests pushed before the loop started.
+        handle->send();
+
+        // Returns once the wakeup handle is closed and the running async tests have finished.
         loop->run();
+
+        {
+            std::unique_lock<std::mutex> lockGuard{ m };
+            wakeup.reset();
+        }
+        loop->close();
+        loop.reset();
 #else
         while (true)
         {
-            doTest(qobject_cast<Qv2rayBase::Plugin::LatencyTestHost *>(parent()));
-            QThread::sleep(1000);
+            {
+                std::unique_lock<std::mutex> lockGuard{ m };
+                wakeup.wait(lockGuard, [this]() { return isStop || !requests.empty(); });
+            }
+            doTest(host);
+            if (isStop)
+                break;
         }
 #endif
+        // No result should be delivered after the thread has finished.
+        syncPool.waitForDone();
+
+        // The thread may be started again after it has been stopped.
+        isStop = false;
     }
 
-#ifndef QV2RAYBASE_NO_LIBUV
-    void LatencyTestThread::doTest(Qv2rayBase::Plugin::LatencyTestHost *parent, uvw::TimerHandle &handle)
-#else
     void LatencyTestThread::doTest(Qv2rayBase::Plugin::LatencyTestHost *parent)
-#endif
     {
-        if (isStop)
+        std::vector<Qv2rayPlugin::Latency::LatencyTestRequest> pending;
         {
-            if (!requests.empty())
-                requests.clear();
-#ifndef QV2RAYBASE_NO_LIBUV
-            int timer_count = 0;
-            uv_walk(
-                loop->raw(),
-                [](uv_handle_t *handle, void *arg)
-                {
-                    int &counter = *static_cast<int *>(arg);
-                    if (uv_is_closing(handle) == 0)
-                        counter++;
-                },
-                &timer_count);
-            if (timer_count == 1) // only current timer
+            std::unique_lock<std::mutex> lockGuard{ m };
+            pending.swap(requests);
+
+            // Pending requests are dropped when stopping.
+            if (isStop)
             {
-                handle.stop();
-                handle.close();
-                loop->clear();
-                loop->close();
-                loop->stop();
+#ifndef QV2RAYBASE_NO_LIBUV
+                if (wakeup && !wakeup->closing())
+                    wakeup->close();
+#endif
             }
-#else
+        }
+
+#ifndef QV2RAYBASE_NO_LIBUV
+        // Finished tests are gone already, the running ones are cancelled so that the loop can return.
+        tcpTests.erase(std::remove_if(tcpTests.begin(), tcpTests.end(), [](const auto &test) { return test.expired(); }), tcpTests.end());
+        if (isStop)
+        {
+            for (const auto &test : tcpTests)
+                if (const auto t = test.lock())
+                    t->Cancel();
+            tcpTests.clear();
+        }
+#endif
+        if (isStop)
             return;
+
+#ifndef QV2RAYBASE_NO_LIBUV
+        const auto &config = Qv2rayBaseLibrary::GetConfig()->plugin_config;
 #endif
-        }
-        else
+        for (const auto &req : pending)
         {
-            if (requests.empty())
-                return;
-            std::unique_lock<std::mutex> lockGuard{ m };
-            for (const auto &req : requests)
+            // Stopping interrupts the remaining blocking tests.
+            if (isStop)
+                break;
+
+#ifndef QV2RAYBASE_NO_LIBUV
+            // The built-in engine shares this loop with all other tests in flight.
+            if (req.engine == BuiltinTcpLatencyTestEngineId)
+            {
+                tcpTests.push_back(TcpLatencyTest::Start(loop, req, config.latency_test_samples, config.latency_test_timeout,
+                                                         [parent, id = req.id](const Qv2rayPlugin::Latency::LatencyTestResponse &resp)
+                                                         { emit parent->OnLatencyTestCompleted(id, resp); }));
+                continue;
+            }
+#endif
+
+            const auto engineInfo = Qv2rayBaseLibrary::PluginAPIHost()->Latency_GetEngine(req.engine);
+            if (!engineInfo.Create)
             {
-                const auto engineInfo = Qv2rayBaseLibrary::PluginAPIHost()->Latency_GetEngine(req.engine);
+                emit parent->OnLatencyTestCompleted(req.id, EngineUnavailableResponse(req));
+                continue;
+            }
+
 #ifndef QV2RAYBASE_NO_LIBUV
-                if (engineInfo.isAsync)
+            if (engineInfo.isAsync)
+            {
+                const auto engine = engineInfo.Create();
+                if (!engine)
                 {
-                    const auto engine = engineInfo.Create();
-                    const auto obj = engine.get();
-                    connect(obj, SIGNAL(OnLatencyTestFinishedSignal(const ConnectionId &, const Qv2rayPlugin::Latency::LatencyTestResponse &)), parent,
-                            SLOT(onLatencyTestCompleted_p(const ConnectionId &, const Qv2rayPlugin::Latency::LatencyTestResponse &)));
-                    engine->TestLatencyAsync(loop, req);
+                    emit parent->OnLatencyTestCompleted(req.id, EngineUnavailableResponse(req));
+                    continue;
                 }
-                else
+                const auto obj = engine.get();
+                connect(obj, SIGNAL(OnLatencyTestFinishedSignal(const ConnectionId &, const Qv2rayPlugin::Latency::LatencyTestResponse &)), parent,
+                        SLOT(onLatencyTestCompleted_p(const ConnectionId &, const Qv2rayPlugin::Latency::LatencyTestResponse &)));
+                engine->TestLatencyAsync(loop, req);
+            }
+            else
 #endif
-                {
-                    // This is a blocking call
-                    const auto resp = engineInfo.Create()->TestLatency(req);
-                    emit parent->OnLatencyTestCompleted(req.id, resp);
-                }
+            {
+                // This is a blocking call, the results are delivered to the host thread via queued connections.
+                syncPool.start(
+                    [this, parent, engineInfo, req]()
+                    {
+                        if (isStop)
+                            return;
+                        const auto engine = engineInfo.Create();
+                        emit parent->OnLatencyTestCompleted(req.id, engine ? engine->TestLatency(req) : EngineUnavailableResponse(req));
+                    });
             }
-            requests.clear();
         }
     }
 
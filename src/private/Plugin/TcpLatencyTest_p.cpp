@@ -0,0 +1,155 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/private/Plugin/TcpLatencyTest_p.hpp"
+
+#ifndef QV2RAYBASE_NO_LIBUV
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace Qv2rayBase::Plugin
+{
+    using namespace Qv2rayPlugin::Latency;
+
+    TcpLatencyTest::TcpLatencyTest(const std::shared_ptr<uvw::Loop> &loop, const LatencyTestRequest &request, int samples, int timeout, Callback callback)
+        : loop(loop), request(request), samples(std::max(1, samples)), timeout(std::max(1, timeout)), callback(std::move(callback))
+    {
+        latencies.reserve(this->samples);
+    }
+
+    std::shared_ptr<TcpLatencyTest> TcpLatencyTest::Start(const std::shared_ptr<uvw::Loop> &loop, const LatencyTestRequest &request, int samples, int timeout,
+                                                          Callback callback)
+    {
+        // Handles in the loop keep the test alive until it finishes.
+        std::shared_ptr<TcpLatencyTest> test{ new TcpLatencyTest(loop, request, samples, timeout, std::move(callback)) };
+        test->Resolve();
+        return test;
+    }
+
+    void TcpLatencyTest::Cancel()
+    {
+        cancelled = true;
+
+        // A resolution already running in the thread pool can't be cancelled, its result is ignored.
+        if (const auto r = resolver.lock())
+            r->cancel();
+        if (const auto h = currentConnection.lock(); h && !h->closing())
+            h->close();
+        if (const auto t = currentTimer.lock(); t && !t->closing())
+            t->close();
+    }
+
+    void TcpLatencyTest::Resolve()
+    {
+        const auto req = loop->resource<uvw::GetAddrInfoReq>();
+        resolver = req;
+        req->once<uvw::ErrorEvent>([self = shared_from_this()](const uvw::ErrorEvent &e, uvw::GetAddrInfoReq &) { self->Finish(QString::fromUtf8(e.what())); });
+        req->once<uvw::AddrInfoEvent>(
+            [self = shared_from_this()](const uvw::AddrInfoEvent &e, uvw::GetAddrInfoReq &)
+            {
+                // Only the first address is tested, which is the one a client would try first.
+                const auto info = e.data.get();
+                std::memcpy(&self->address, info->ai_addr, std::min<size_t>(info->ai_addrlen, sizeof(self->address)));
+                if (info->ai_family == AF_INET)
+                    reinterpret_cast<sockaddr_in *>(&self->address)->sin_port = htons(quint16(self->request.port));
+                else if (info->ai_family == AF_INET6)
+                    reinterpret_cast<sockaddr_in6 *>(&self->address)->sin6_port = htons(quint16(self->request.port));
+                else
+                    return self->Finish(u"Unsupported address family."_qs);
+                self->NextSample();
+            });
+        req->nodeAddrInfo(request.host.toStdString());
+    }
+
+    void TcpLatencyTest::NextSample()
+    {
+        if (cancelled)
+            return;
+        if (completed == samples)
+            return Finish(lastError);
+
+        const auto tcp = loop->resource<uvw::TCPHandle>();
+        const auto timer = loop->resource<uvw::TimerHandle>();
+        currentConnection = tcp;
+        currentTimer = timer;
+        const auto started = std::chrono::steady_clock::now();
+
+        // Closing a connecting handle reports an error as well, only the first outcome of a sample counts.
+        const auto settled = std::make_shared<bool>(false);
+        const auto settle = [self = shared_from_this(), settled, tcpRef = std::weak_ptr{ tcp }, timerRef = std::weak_ptr{ timer }](std::optional<long> latency,
+                                                                                                                                    const QString &error)
+        {
+            if (std::exchange(*settled, true))
+                return;
+            if (const auto h = tcpRef.lock(); h && !h->closing())
+                h->close();
+            if (const auto t = timerRef.lock(); t && !t->closing())
+                t->close();
+            self->OnSample(latency, error);
+        };
+
+        tcp->once<uvw::ConnectEvent>(
+            [settle, started](const uvw::ConnectEvent &, uvw::TCPHandle &)
+            {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+                settle(static_cast<long>(elapsed.count()), {});
+            });
+        tcp->once<uvw::ErrorEvent>([settle](const uvw::ErrorEvent &e, uvw::TCPHandle &) { settle(std::nullopt, QString::fromUtf8(e.what())); });
+        timer->once<uvw::TimerEvent>([settle](const uvw::TimerEvent &, uvw::TimerHandle &) { settle(std::nullopt, u"Connection timed out."_qs); });
+
+        timer->start(uvw::TimerHandle::Time{ timeout }, uvw::TimerHandle::Time{ 0 });
+        tcp->connect(reinterpret_cast<const sockaddr &>(address));
+    }
+
+    void TcpLatencyTest::OnSample(std::optional<long> latency, const QString &error)
+    {
+        completed++;
+        if (latency)
+            latencies.push_back(*latency);
+        else
+            lastError = error;
+        NextSample();
+    }
+
+    void TcpLatencyTest::Finish(const QString &error)
+    {
+        if (cancelled)
+            return;
+
+        LatencyTestResponse response;
+        response.engine = request.engine;
+        response.total = samples;
+        response.succeeded = static_cast<int>(latencies.size());
+        response.failed = samples - response.succeeded;
+        response.error = error;
+
+        if (latencies.empty())
+        {
+            response.avg = response.min = response.max = LATENCY_TEST_VALUE_ERROR;
+        }
+        else
+        {
+            const auto [min, max] = std::minmax_element(latencies.cbegin(), latencies.cend());
+            response.min = *min;
+            response.max = *max;
+            response.avg = std::accumulate(latencies.cbegin(), latencies.cend(), 0L) / static_cast<long>(latencies.size());
+        }
+        callback(response);
+    }
+} // namespace Qv2rayBase::Plugin
+#endif
@@ -0,0 +1,149 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/private/Profile/AccessLogAggregator_p.hpp"
+
+#include <algorithm>
+
+namespace Qv2rayBase::Profile
+{
+    constexpr QStringView ACCEPTED = u" accepted ";
+    constexpr QStringView REJECTED = u" rejected ";
+
+    static QList<std::pair<QString, quint64>> TopK(const QHash<QString, quint64> &counts, int k)
+    {
+        QList<std::pair<QString, quint64>> result;
+        result.reserve(counts.size());
+        for (auto it = counts.constKeyValueBegin(); it != counts.constKeyValueEnd(); ++it)
+            result.append(*it);
+
+        const auto n = std::clamp<qsizetype>(k, 0, result.size());
+        std::partial_sort(result.begin(), result.begin() + n, result.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+        result.resize(n);
+        return result;
+    }
+
+    // Take the next space-separated token from line, starting at pos.
+    static QStringView NextToken(QStringView line, qsizetype &pos)
+    {
+        while (pos < line.size() && line[pos] == u' ')
+            pos++;
+        const auto begin = pos;
+        while (pos < line.size() && line[pos] != u' ')
+            pos++;
+        return line.sliced(begin, pos - begin);
+    }
+
+    bool AccessLogAggregator::Parse(QStringView line, AccessLogEntry &entry)
+    {
+        // V2Ray: 2021/01/01 00:00:00 127.0.0.1:1080 accepted tcp:example.com:443 [socks >> proxy]
+        // Xray:  2021/01/01 00:00:00 from 127.0.0.1:1080 accepted tcp:example.com:443 [socks -> proxy]
+        //        2021/01/01 00:00:00 127.0.0.1:1080 rejected  proxy/socks: unknown command
+        qsizetype keyword = line.indexOf(ACCEPTED);
+        entry.accepted = keyword >= 0;
+        if (!entry.accepted)
+        {
+            keyword = line.indexOf(REJECTED);
+            if (keyword < 0)
+                return false;
+        }
+
+        const auto head = line.first(keyword);
+        const auto sourceBegin = head.lastIndexOf(u' ');
+        entry.source = head.sliced(sourceBegin + 1);
+        entry.destination = {};
+        entry.inboundTag = {};
+        entry.outboundTag = {};
+
+        if (!entry.accepted)
+            return true;
+
+        qsizetype pos = keyword + ACCEPTED.size();
+        auto destination = NextToken(line, pos);
+        // Remove the network prefix and the port.
+        if (destination.startsWith(QStringView{ u"tcp:" }) || destination.startsWith(QStringView{ u"udp:" }))
+            destination = destination.sliced(4);
+        if (const auto colon = destination.lastIndexOf(u':'); colon > 0)
+            destination = destination.first(colon);
+        if (destination.startsWith(u'[') && destination.endsWith(u']'))
+            destination = destination.sliced(1, destination.size() - 2);
+        entry.destination = destination;
+
+        const auto bracketBegin = line.indexOf(u'[', pos);
+        const auto bracketEnd = bracketBegin < 0 ? -1 : line.indexOf(u']', bracketBegin);
+        if (bracketEnd > bracketBegin)
+        {
+            const auto route = line.sliced(bracketBegin + 1, bracketEnd - bracketBegin - 1);
+            auto arrow = route.indexOf(QStringView{ u" >> " });
+            if (arrow < 0)
+                arrow = route.indexOf(QStringView{ u" -> " });
+            if (arrow >= 0)
+            {
+                entry.inboundTag = route.first(arrow).trimmed();
+                entry.outboundTag = route.sliced(arrow + 4).trimmed();
+            }
+            else
+            {
+                entry.inboundTag = route.trimmed();
+            }
+        }
+        return true;
+    }
+
+    void AccessLogAggregator::Add(QStringView line)
+    {
+        AccessLogEntry entry;
+        if (!Parse(line, entry))
+            return;
+
+        if (!entry.accepted)
+        {
+            rejected++;
+            return;
+        }
+
+        accepted++;
+        if (!entry.destination.isEmpty())
+        {
+            const auto key = entry.destination.toString();
+            if (destinations.contains(key) || destinations.size() < MaxDestinations)
+                destinations[key]++;
+            else
+                destinations[OtherDestinations]++;
+        }
+
+        if (!entry.outboundTag.isEmpty())
+            outbounds[entry.outboundTag.toString()]++;
+    }
+
+    void AccessLogAggregator::Clear()
+    {
+        accepted = 0, rejected = 0;
+        destinations.clear();
+        outbounds.clear();
+    }
+
+    QList<std::pair<QString, quint64>> AccessLogAggregator::TopDestinations(int k) const
+    {
+        return TopK(destinations, k);
+    }
+
+    QList<std::pair<QString, quint64>> AccessLogAggregator::TopOutbounds(int k) const
+    {
+        return TopK(outbounds, k);
+    }
+} // namespace Qv2rayBase::Profile
@@ -0,0 +1,226 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/ConnectionIndex_p.hpp"
+
+#include "Qv2rayBase/Common/ProfileHelpers.hpp"
+#include "QvPlugin/Handlers/LatencyTestHandler.hpp"
+
+namespace Qv2rayBase::Profile
+{
+    QStringList ConnectionIndex::Tokenize(const QString &str)
+    {
+        QStringList tokens;
+        QString current;
+        for (const auto &ch : str)
+        {
+            if (ch.isLetterOrNumber())
+            {
+                current += ch.toLower();
+            }
+            else if (!current.isEmpty())
+            {
+                tokens << current;
+                current.clear();
+            }
+        }
+        if (!current.isEmpty())
+            tokens << current;
+        tokens.removeDuplicates();
+        return tokens;
+    }
+
+    void ConnectionIndex::Update(const ConnectionId &id, const ConnectionObject &object, const ProfileContent &content)
+    {
+        Remove(id);
+
+        IndexedEntry entry;
+        entry.nameTokens = Tokenize(object.name);
+        for (const auto &tag : object.tags)
+            entry.tags << tag.toLower();
+
+        if (!content.outbounds.isEmpty())
+        {
+            const auto &[protocol, host, port] = GetOutboundInfo(content.outbounds.first());
+            entry.protocol = protocol.toLower();
+            entry.host = host.toLower();
+            entry.port = port.from;
+        }
+
+        for (const auto &token : entry.nameTokens)
+            nameIndex[token].insert(id);
+        for (const auto &tag : entry.tags)
+            tagIndex[tag].insert(id);
+        if (!entry.protocol.isEmpty())
+            protocolIndex[entry.protocol].insert(id);
+        if (!entry.host.isEmpty())
+            hostIndex[entry.host].insert(id);
+        if (entry.port > 0)
+            portIndex[entry.port].insert(id);
+
+        entries.insert(id, entry);
+    }
+
+    void ConnectionIndex::Remove(const ConnectionId &id)
+    {
+        const auto entryIt = entries.constFind(id);
+        if (entryIt == entries.constEnd())
+            return;
+
+        const auto removeFrom = [&id](auto &index, const auto &key)
+        {
+            auto it = index.find(key);
+            if (it == index.end())
+                return;
+            it->remove(id);
+            if (it->isEmpty())
+                index.erase(it);
+        };
+
+        const auto &entry = *entryIt;
+        for (const auto &token : entry.nameTokens)
+            removeFrom(nameIndex, token);
+        for (const auto &tag : entry.tags)
+            removeFrom(tagIndex, tag);
+        removeFrom(protocolIndex, entry.protocol);
+        removeFrom(hostIndex, entry.host);
+        removeFrom(portIndex, entry.port);
+
+        entries.erase(entryIt);
+    }
+
+    void ConnectionIndex::Clear()
+    {
+        entries.clear();
+        nameIndex.clear();
+        tagIndex.clear();
+        protocolIndex.clear();
+        hostIndex.clear();
+        portIndex.clear();
+    }
+
+    QList<ConnectionId> ConnectionIndex::Query(const QString &query, const QHash<ConnectionId, ConnectionObject> &connections) const
+    {
+        static const QSet<ConnectionId> emptySet;
+
+        QList<const QSet<ConnectionId> *> postings;
+        QList<std::function<bool(int)>> latencyFilters;
+
+        const auto addPosting = [&postings](const auto &index, const auto &key)
+        {
+            const auto it = index.constFind(key);
+            postings << (it == index.constEnd() ? &emptySet : &it.value());
+        };
+
+        const auto addNameTokens = [&](const QString &str)
+        {
+            for (const auto &token : Tokenize(str))
+                addPosting(nameIndex, token);
+        };
+
+        for (const auto &term : query.split(QChar(' '), Qt::SkipEmptyParts))
+        {
+            if (term.startsWith(u"latency"_qs, Qt::CaseInsensitive) && term.size() > 7 && QStringLiteral("<>=").contains(term.at(7)))
+            {
+                auto op = term.mid(7, 1);
+                if (term.size() > 8 && term.at(8) == QChar('='))
+                    op += QChar('=');
+
+                bool ok = false;
+                const auto value = term.mid(7 + op.size()).toInt(&ok);
+                if (!ok)
+                {
+                    qInfo() << "Invalid latency filter in query:" << term;
+                    return {};
+                }
+
+                if (op == u"<"_qs)
+                    latencyFilters << [value](int l) { return l < value; };
+                else if (op == u"<="_qs)
+                    latencyFilters << [value](int l) { return l <= value; };
+                else if (op == u">"_qs)
+                    latencyFilters << [value](int l) { return l > value; };
+                else if (op == u">="_qs)
+                    latencyFilters << [value](int l) { return l >= value; };
+                else
+                    latencyFilters << [value](int l) { return l == value; };
+                continue;
+            }
+
+            const auto colon = term.indexOf(QChar(':'));
+            if (colon <= 0)
+            {
+                addNameTokens(term);
+                continue;
+            }
+
+            const auto key = term.left(colon).toLower();
+            const auto value = term.mid(colon + 1).toLower();
+
+            if (key == u"tag"_qs)
+                addPosting(tagIndex, value);
+            else if (key == u"protocol"_qs)
+                addPosting(protocolIndex, value);
+            else if (key == u"host"_qs)
+                addPosting(hostIndex, value);
+            else if (key == u"port"_qs)
+                addPosting(portIndex, value.toInt());
+            else if (key == u"name"_qs)
+                addNameTokens(value);
+            else
+                addNameTokens(term);
+        }
+
+        const auto matchesLatency = [&](const ConnectionId &id)
+        {
+            if (latencyFilters.isEmpty())
+                return true;
+            const auto it = connections.constFind(id);
+            if (it == connections.constEnd())
+                return false;
+            // Untested and failed connections have no latency to compare.
+            if (it->latency < 0 || it->latency == LATENCY_TEST_VALUE_NODATA || it->latency == LATENCY_TEST_VALUE_ERROR)
+                return false;
+            for (const auto &filter : latencyFilters)
+                if (!filter(it->latency))
+                    return false;
+            return true;
+        };
+
+        QList<ConnectionId> result;
+
+        // Only latency filters, scan everything.
+        if (postings.isEmpty())
+        {
+            for (auto it = connections.constKeyValueBegin(); it != connections.constKeyValueEnd(); it++)
+                if (matchesLatency(it->first))
+                    result << it->first;
+            return result;
+        }
+
+        // Walk the smallest posting list and probe the others.
+        std::sort(postings.begin(), postings.end(), [](const auto *a, const auto *b) { return a->size() < b->size(); });
+        for (const auto &id : *postings.first())
+        {
+            bool matched = true;
+            for (auto i = 1; i < postings.size() && matched; i++)
+                matched = postings.at(i)->contains(id);
+            if (matched && matchesLatency(id))
+                result << id;
+        }
+        return result;
+    }
+} // namespace Qv2rayBase::Profile
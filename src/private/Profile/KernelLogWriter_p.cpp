@@ -0,0 +1,212 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/private/Profile/KernelLogWriter_p.hpp"
+
+#include <QDateTime>
+
+#ifdef QV2RAYBASE_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+// Logs are written when this amount of text is pending, or after the interval.
+constexpr auto LOG_WRITE_BATCH_SIZE = 64 * 1024;
+constexpr auto LOG_WRITE_INTERVAL = 1000;
+// Appending is never blocked by a slow disk, logs beyond this are dropped.
+constexpr auto LOG_MAX_PENDING_SIZE = 16 * 1024 * 1024;
+const static QString LOG_FILE_NAME = u"kernel.log"_qs;
+// Rotated segments are compressed in chunks of this size, they are never read into memory at once.
+constexpr auto LOG_COMPRESS_CHUNK_SIZE = 64 * 1024;
+
+namespace Qv2rayBase::Profile
+{
+#ifdef QV2RAYBASE_HAS_ZLIB
+    static bool GzipFile(const QString &sourcePath, const QString &targetPath)
+    {
+        QFile source{ sourcePath };
+        QFile target{ targetPath };
+        if (!source.open(QIODevice::ReadOnly) || !target.open(QIODevice::WriteOnly))
+            return false;
+
+        // 15 window bits, plus 16 to write a gzip header instead of a zlib one.
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+
+        QByteArray input(LOG_COMPRESS_CHUNK_SIZE, Qt::Uninitialized);
+        QByteArray output(LOG_COMPRESS_CHUNK_SIZE, Qt::Uninitialized);
+        bool succeeded = true;
+        auto flush = Z_NO_FLUSH;
+        while (succeeded && flush != Z_FINISH)
+        {
+            const auto read = source.read(input.data(), input.size());
+            if (read < 0)
+            {
+                succeeded = false;
+                break;
+            }
+
+            flush = source.atEnd() ? Z_FINISH : Z_NO_FLUSH;
+            stream.next_in = reinterpret_cast<Bytef *>(input.data());
+            stream.avail_in = static_cast<uInt>(read);
+            do
+            {
+                stream.next_out = reinterpret_cast<Bytef *>(output.data());
+                stream.avail_out = static_cast<uInt>(output.size());
+                deflate(&stream, flush);
+                const auto produced = output.size() - static_cast<qsizetype>(stream.avail_out);
+                if (target.write(output.constData(), produced) != produced)
+                {
+                    succeeded = false;
+                    break;
+                }
+            } while (stream.avail_out == 0);
+        }
+        deflateEnd(&stream);
+        return succeeded && target.flush();
+    }
+#else
+    static bool GzipFile(const QString &, const QString &)
+    {
+        return false;
+    }
+#endif
+
+    KernelLogWriter::KernelLogWriter(const Options &options, QObject *parent) : QThread(parent), options(options)
+    {
+        setObjectName(u"KernelLogWriter"_qs);
+    }
+
+    KernelLogWriter::~KernelLogWriter()
+    {
+        Stop();
+        wait();
+    }
+
+    void KernelLogWriter::Append(const QString &lines)
+    {
+        QMutexLocker locker{ &mutex };
+        if (pendingSize > LOG_MAX_PENDING_SIZE)
+        {
+            dropped++;
+            return;
+        }
+
+        pending.append({ QDateTime::currentMSecsSinceEpoch(), lines });
+        pendingSize += lines.size();
+        if (pendingSize >= LOG_WRITE_BATCH_SIZE)
+            condition.wakeOne();
+    }
+
+    void KernelLogWriter::Stop()
+    {
+        QMutexLocker locker{ &mutex };
+        stopping = true;
+        condition.wakeOne();
+    }
+
+    bool KernelLogWriter::Open(QFile &file)
+    {
+        if (!QDir().mkpath(options.directory))
+            return false;
+        file.setFileName(QDir(options.directory).filePath(LOG_FILE_NAME));
+        return file.open(QIODevice::WriteOnly | QIODevice::Append);
+    }
+
+    void KernelLogWriter::run()
+    {
+        QFile file;
+        if (!Open(file))
+        {
+            qInfo() << "Cannot open kernel log file:" << file.fileName();
+            return;
+        }
+
+        auto openedAt = QDateTime::currentMSecsSinceEpoch();
+        while (true)
+        {
+            QList<std::pair<qint64, QString>> entries;
+            quint64 droppedEntries = 0;
+            bool stop = false;
+            {
+                QMutexLocker locker{ &mutex };
+                if (!stopping && pendingSize < LOG_WRITE_BATCH_SIZE)
+                    condition.wait(&mutex, LOG_WRITE_INTERVAL);
+                entries = std::exchange(pending, {});
+                droppedEntries = std::exchange(dropped, 0);
+                pendingSize = 0;
+                stop = stopping;
+            }
+
+            // Formatting happens here, so the callers only pay for a locked append.
+            QByteArray buffer;
+            for (const auto &[time, lines] : entries)
+            {
+                const auto prefix = QDateTime::fromMSecsSinceEpoch(time).toString(Qt::ISODateWithMs).toUtf8() + ' ';
+                for (const auto &line : QStringView{ lines }.split(u'\n', Qt::SkipEmptyParts))
+                    buffer += prefix + line.toUtf8() + '\n';
+            }
+            if (droppedEntries > 0)
+                buffer += "[Qv2rayBase] " + QByteArray::number(droppedEntries) + " log batches were dropped.\n";
+
+            if (!buffer.isEmpty())
+            {
+                file.write(buffer);
+                file.flush();
+            }
+
+            const auto now = QDateTime::currentMSecsSinceEpoch();
+            if (file.size() >= options.maxSize || (options.maxAge > 0 && now - openedAt >= options.maxAge))
+            {
+                Rotate(file);
+                openedAt = now;
+                if (!file.isOpen())
+                    return;
+            }
+
+            if (stop)
+                break;
+        }
+        file.close();
+    }
+
+    void KernelLogWriter::Rotate(QFile &file)
+    {
+        // Nothing to rotate.
+        if (file.size() == 0)
+            return;
+
+        file.close();
+        const QDir dir{ options.directory };
+        const auto rotatedName = dir.filePath(u"kernel-%1.log"_qs.arg(QDateTime::currentDateTime().toString(u"yyyyMMdd-hhmmsszzz"_qs)));
+        if (QFile::rename(file.fileName(), rotatedName) && options.compress)
+        {
+            // A partially written archive is useless, keep the plain segment instead.
+            // Without zlib GzipFile always fails and the segments stay uncompressed.
+            const auto compressedName = rotatedName + u".gz"_qs;
+            QFile::remove(GzipFile(rotatedName, compressedName) ? rotatedName : compressedName);
+        }
+
+        // File names contain the rotation time, remove the oldest segments.
+        auto segments = dir.entryList({ u"kernel-*.log"_qs, u"kernel-*.log.gz"_qs }, QDir::Files, QDir::Name);
+        while (segments.size() > options.keepCount)
+            QFile::remove(dir.filePath(segments.takeFirst()));
+
+        if (!Open(file))
+            qInfo() << "Cannot reopen kernel log file:" << file.fileName();
+    }
+} // namespace Qv2rayBase::Profile
@@ -15,3 +15,44 @@
 //  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "Qv2rayBase/private/Profile/KernelManager_p.hpp"
+
+#include <algorithm>
+
+namespace Qv2rayBase::Profile
+{
+    // The capacity comes from the user configuration, the ring keeps at least the latest line.
+    KernelLogBuffer::KernelLogBuffer(qsizetype capacity) : ring(std::max(capacity, qsizetype{ 1 }))
+    {
+    }
+
+    void KernelLogBuffer::Push(QString &&line)
+    {
+        const auto capacity = static_cast<qsizetype>(ring.size());
+        ring[(head + size) % capacity] = std::move(line);
+        if (size < capacity)
+        {
+            size++;
+        }
+        else
+        {
+            head = (head + 1) % capacity;
+            dropped++;
+        }
+    }
+
+    QStringList KernelLogBuffer::TakeAll()
+    {
+        const auto capacity = static_cast<qsizetype>(ring.size());
+        QStringList lines;
+        lines.reserve(size);
+        for (qsizetype i = 0; i < size; i++)
+            lines << std::move(ring[(head + i) % capacity]);
+        head = 0, size = 0;
+        return lines;
+    }
+
+    quint64 KernelLogBuffer::TakeDropped()
+    {
+        return std::exchange(dropped, 0);
+    }
+} // namespace Qv2rayBase::Profile
@@ -0,0 +1,117 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/private/Profile/KernelReadinessProbe_p.hpp"
+
+#include <QTcpSocket>
+#include <algorithm>
+
+constexpr qint64 READINESS_PROBE_INITIAL_DELAY = 20;
+constexpr qint64 READINESS_PROBE_MAX_DELAY = 500;
+// A single connection attempt never takes longer than this.
+constexpr qint64 READINESS_PROBE_CONNECT_TIMEOUT = 1000;
+
+namespace Qv2rayBase::Profile
+{
+    KernelReadinessProbe::KernelReadinessProbe(const QList<Endpoint> &endpoints, qint64 timeout, QObject *parent)
+        : QObject(parent), pending(endpoints), timeout(timeout), delay(READINESS_PROBE_INITIAL_DELAY)
+    {
+        deadline.setSingleShot(true);
+        retry.setSingleShot(true);
+        connect(&deadline, &QTimer::timeout, this, [this]() { finish(std::nullopt); });
+        connect(&retry, &QTimer::timeout, this, &KernelReadinessProbe::tryConnect);
+    }
+
+    void KernelReadinessProbe::Start()
+    {
+        elapsed.start();
+        deadline.start(int(timeout));
+        tryConnect();
+    }
+
+    void KernelReadinessProbe::tryConnect()
+    {
+        if (pending.isEmpty())
+            return finish(elapsed.elapsed());
+
+        for (const auto &endpoint : pending)
+        {
+            const auto socket = new QTcpSocket(this);
+            connect(socket, &QTcpSocket::connected, this, [this, socket]() { onAttemptFinished(socket, true); });
+            connect(socket, &QTcpSocket::errorOccurred, this, [this, socket]() { onAttemptFinished(socket, false); });
+            attempts << socket;
+            socket->connectToHost(endpoint.address, endpoint.port);
+        }
+
+        // Whatever is still connecting by then counts as not ready.
+        QTimer::singleShot(std::min(READINESS_PROBE_CONNECT_TIMEOUT, timeout), this,
+                           [this, current = ++round]()
+                           {
+                               if (current != round)
+                                   return;
+                               for (const auto socket : QList{ attempts })
+                                   if (socket)
+                                       onAttemptFinished(socket, false);
+                           });
+    }
+
+    void KernelReadinessProbe::onAttemptFinished(QTcpSocket *socket, bool connected)
+    {
+        const auto index = attempts.indexOf(socket);
+        if (finished || index < 0)
+            return;
+
+        // Attempts of a round are in the same order as the pending endpoints, null entries are finished ones.
+        attempts[index] = nullptr;
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+        if (connected)
+            pending[index] = Endpoint{};
+
+        if (std::any_of(attempts.cbegin(), attempts.cend(), [](const QTcpSocket *s) { return s != nullptr; }))
+            return;
+
+        attempts.clear();
+        pending.removeIf([](const Endpoint &e) { return e.port == 0; });
+        if (pending.isEmpty())
+            return finish(elapsed.elapsed());
+
+        retry.start(int(delay));
+        delay = std::min(delay * 2, READINESS_PROBE_MAX_DELAY);
+    }
+
+    void KernelReadinessProbe::finish(std::optional<qint64> readyTime)
+    {
+        if (finished)
+            return;
+        finished = true;
+
+        deadline.stop();
+        retry.stop();
+        for (const auto socket : qAsConst(attempts))
+        {
+            if (!socket)
+                continue;
+            socket->disconnect(this);
+            socket->abort();
+            socket->deleteLater();
+        }
+        attempts.clear();
+        emit OnFinished(readyTime);
+    }
+} // namespace Qv2rayBase::Profile
@@ -0,0 +1,103 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/LatencyHistory_p.hpp"
+
+#include "QvPlugin/Handlers/LatencyTestHandler.hpp"
+
+#include <QtEndian>
+#include <algorithm>
+
+namespace Qv2rayBase::Profile
+{
+    bool LatencyHistory::IsSuccessful(long latency)
+    {
+        return latency >= 0 && latency < LATENCY_TEST_VALUE_NODATA;
+    }
+
+    void LatencyHistory::Push(int latency)
+    {
+        samples[head] = latency < 0 ? FailedSample : static_cast<quint16>(std::min(latency, FailedSample - 1));
+        head = (head + 1) % Capacity;
+        count = std::min(count + 1, Capacity);
+    }
+
+    int LatencyHistory::Size() const
+    {
+        return count;
+    }
+
+    int LatencyHistory::FailedCount() const
+    {
+        int failed = 0;
+        for (auto i = 0; i < count; i++)
+            failed += samples[(head - count + i + Capacity) % Capacity] == FailedSample;
+        return failed;
+    }
+
+    QList<quint16> LatencyHistory::successfulSamples() const
+    {
+        QList<quint16> result;
+        result.reserve(count);
+        for (auto i = 0; i < count; i++)
+            if (const auto sample = samples[(head - count + i + Capacity) % Capacity]; sample != FailedSample)
+                result << sample;
+        return result;
+    }
+
+    int LatencyHistory::Percentile(int percent) const
+    {
+        auto values = successfulSamples();
+        if (values.isEmpty())
+            return -1;
+
+        const auto rank = std::clamp((percent * values.size() + 99) / 100, qsizetype{ 1 }, values.size());
+        std::nth_element(values.begin(), values.begin() + rank - 1, values.end());
+        return values.at(rank - 1);
+    }
+
+    int LatencyHistory::Jitter() const
+    {
+        const auto values = successfulSamples();
+        if (values.size() < 2)
+            return 0;
+
+        qint64 sum = 0;
+        for (auto i = 1; i < values.size(); i++)
+            sum += std::abs(values.at(i) - values.at(i - 1));
+        return static_cast<int>(sum / (values.size() - 1));
+    }
+
+    QByteArray LatencyHistory::Serialize() const
+    {
+        QByteArray data(count * sizeof(quint16), Qt::Uninitialized);
+        for (auto i = 0; i < count; i++)
+            qToLittleEndian<quint16>(samples[(head - count + i + Capacity) % Capacity], data.data() + i * sizeof(quint16));
+        return data;
+    }
+
+    LatencyHistory LatencyHistory::Deserialize(const QByteArray &data)
+    {
+        LatencyHistory history;
+        const auto size = data.size() / qsizetype(sizeof(quint16));
+        for (auto i = std::max<qsizetype>(0, size - Capacity); i < size; i++)
+        {
+            const auto sample = qFromLittleEndian<quint16>(data.constData() + i * sizeof(quint16));
+            history.Push(sample == FailedSample ? -1 : sample);
+        }
+        return history;
+    }
+} // namespace Qv2rayBase::Profile
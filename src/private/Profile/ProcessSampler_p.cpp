@@ -0,0 +1,102 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/private/Profile/ProcessSampler_p.hpp"
+
+#include <QDeadlineTimer>
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace Qv2rayBase::Profile
+{
+#ifdef Q_OS_LINUX
+    static QByteArray ReadProcFile(qint64 pid, const char *name)
+    {
+        // Files in /proc report a size of zero, read until the end.
+        QFile file{ QStringLiteral("/proc/%1/%2").arg(pid).arg(QLatin1String(name)) };
+        if (!file.open(QIODevice::ReadOnly))
+            return {};
+        return file.readAll();
+    }
+
+    // Find "\nkey:   value ..." in a /proc status-like file.
+    static quint64 ReadField(const QByteArray &content, const QByteArray &key)
+    {
+        const auto begin = content.indexOf(key);
+        if (begin < 0)
+            return 0;
+        const auto end = content.indexOf('\n', begin);
+        auto value = content.mid(begin + key.size(), end < 0 ? -1 : end - begin - key.size()).trimmed();
+        if (const auto space = value.indexOf(' '); space >= 0)
+            value.truncate(space);
+        return value.toULongLong();
+    }
+#endif
+
+    std::optional<ProcessSampler::Sample> ProcessSampler::Read(qint64 pid)
+    {
+#ifdef Q_OS_LINUX
+        if (pid <= 0)
+            return std::nullopt;
+
+        const auto stat = ReadProcFile(pid, "stat");
+        // The process name may contain spaces and parentheses, fields start after the last ')'.
+        const auto nameEnd = stat.lastIndexOf(')');
+        if (nameEnd < 0)
+            return std::nullopt;
+
+        // Fields after the name start from the 3rd one: state.
+        const auto fields = stat.mid(nameEnd + 2).split(' ');
+        if (fields.size() < 18)
+            return std::nullopt;
+
+        Sample sample;
+        sample.time = QDeadlineTimer::current().deadline();
+        sample.cpuTicks = fields[11].toULongLong() + fields[12].toULongLong(); // utime, stime
+        sample.threads = fields[17].toInt();                                   // num_threads
+
+        sample.rss = ReadField(ReadProcFile(pid, "status"), "\nVmRSS:") * 1024;
+
+        // Reading io requires the same user, it's fine to leave them zero otherwise.
+        const auto io = ReadProcFile(pid, "io");
+        sample.readBytes = ReadField(io, "\nread_bytes:");
+        sample.writeBytes = ReadField(io, "\nwrite_bytes:");
+        return sample;
+#else
+        Q_UNUSED(pid);
+        return std::nullopt;
+#endif
+    }
+
+    double ProcessSampler::CpuUsage(const Sample &previous, const Sample &current)
+    {
+#ifdef Q_OS_LINUX
+        const auto elapsed = current.time - previous.time;
+        if (elapsed <= 0 || current.cpuTicks < previous.cpuTicks)
+            return 0;
+        static const auto ticksPerSecond = sysconf(_SC_CLK_TCK);
+        return (current.cpuTicks - previous.cpuTicks) * 100'000.0 / ticksPerSecond / elapsed;
+#else
+        Q_UNUSED(previous);
+        Q_UNUSED(current);
+        return 0;
+#endif
+    }
+} // namespace Qv2rayBase::Profile
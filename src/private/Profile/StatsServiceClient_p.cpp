@@ -0,0 +1,335 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/private/Profile/StatsServiceClient_p.hpp"
+
+#include <QNetworkReply>
+#include <QtEndian>
+#include <limits>
+
+// The gRPC message prefix: one compression flag byte and a 4-byte big-endian length.
+constexpr auto GRPC_MESSAGE_PREFIX_SIZE = 5;
+constexpr auto GRPC_STATS_SERVICE = "/v2ray.core.app.stats.command.StatsService/";
+
+namespace Qv2rayBase::Profile
+{
+    namespace
+    {
+        enum WireType
+        {
+            WIRE_VARINT = 0,
+            WIRE_FIXED64 = 1,
+            WIRE_LENGTH_DELIMITED = 2,
+            WIRE_FIXED32 = 5,
+        };
+
+        void WriteVarint(QByteArray &out, quint64 value)
+        {
+            while (value >= 0x80)
+            {
+                out.append(char((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            out.append(char(value));
+        }
+
+        ///
+        /// \brief Reads protobuf fields from a message, all methods return false on malformed input.
+        ///
+        class ProtobufReader
+        {
+          public:
+            explicit ProtobufReader(QByteArrayView data) : data(data)
+            {
+            }
+
+            bool AtEnd() const
+            {
+                return pos >= data.size();
+            }
+
+            bool ReadVarint(quint64 &value)
+            {
+                value = 0;
+                for (int shift = 0; shift < 64; shift += 7)
+                {
+                    if (AtEnd())
+                        return false;
+                    const auto byte = quint8(data[pos++]);
+                    value |= quint64(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        return true;
+                }
+                return false;
+            }
+
+            bool ReadTag(quint32 &field, quint32 &wireType)
+            {
+                quint64 tag;
+                if (!ReadVarint(tag) || tag > std::numeric_limits<quint32>::max())
+                    return false;
+                field = quint32(tag >> 3), wireType = quint32(tag & 0x07);
+                return field != 0;
+            }
+
+            bool ReadBytes(QByteArrayView &value)
+            {
+                quint64 length;
+                if (!ReadVarint(length) || length > quint64(data.size() - pos))
+                    return false;
+                value = data.sliced(pos, qsizetype(length));
+                pos += qsizetype(length);
+                return true;
+            }
+
+            bool Skip(quint32 wireType)
+            {
+                quint64 varint;
+                QByteArrayView bytes;
+                switch (wireType)
+                {
+                    case WIRE_VARINT: return ReadVarint(varint);
+                    case WIRE_LENGTH_DELIMITED: return ReadBytes(bytes);
+                    case WIRE_FIXED64: return (pos += 8) <= data.size();
+                    case WIRE_FIXED32: return (pos += 4) <= data.size();
+                    default: return false;
+                }
+            }
+
+          private:
+            QByteArrayView data;
+            qsizetype pos = 0;
+        };
+
+        std::optional<std::pair<QString, qint64>> DecodeStat(QByteArrayView message)
+        {
+            std::pair<QString, qint64> stat;
+            ProtobufReader reader{ message };
+            quint32 field, wireType;
+            while (!reader.AtEnd())
+            {
+                if (!reader.ReadTag(field, wireType))
+                    return std::nullopt;
+
+                if (field == 1 && wireType == WIRE_LENGTH_DELIMITED)
+                {
+                    QByteArrayView name;
+                    if (!reader.ReadBytes(name))
+                        return std::nullopt;
+                    stat.first = QString::fromUtf8(name);
+                }
+                else if (field == 2 && wireType == WIRE_VARINT)
+                {
+                    quint64 value;
+                    if (!reader.ReadVarint(value))
+                        return std::nullopt;
+                    stat.second = static_cast<qint64>(value);
+                }
+                else if (!reader.Skip(wireType))
+                    return std::nullopt;
+            }
+            return stat;
+        }
+
+        // The HTTP/2 backend appends the trailing HEADERS frame to the headers of the reply, so trailers are the
+        // last occurrence of a field once the reply has finished. rawHeader() would join it with the earlier ones.
+        std::optional<QByteArray> GetTrailer(const QNetworkReply *reply, const QByteArray &name)
+        {
+            std::optional<QByteArray> value;
+            for (const auto &[header, headerValue] : reply->rawHeaderPairs())
+                if (header.compare(name, Qt::CaseInsensitive) == 0)
+                    value = headerValue;
+            return value;
+        }
+    } // namespace
+
+    StatsServiceClient::StatsServiceClient(const QString &host, int port, QObject *parent) : QObject(parent)
+    {
+        baseUrl.setScheme(u"http"_qs);
+        baseUrl.setHost(host);
+        baseUrl.setPort(port);
+    }
+
+    void StatsServiceClient::QueryStats(const QString &pattern, bool reset)
+    {
+        Call(u"QueryStats"_qs, EncodeQueryStatsRequest(pattern, reset),
+             [this](const QByteArray &message)
+             {
+                 if (const auto stats = DecodeQueryStatsResponse(message); stats)
+                     emit OnStatsReceived(*stats);
+                 else
+                     emit OnError(u"QueryStats"_qs, u"Malformed response."_qs);
+             });
+    }
+
+    void StatsServiceClient::GetSysStats()
+    {
+        // SysStatsRequest has no fields.
+        Call(u"GetSysStats"_qs, {},
+             [this](const QByteArray &message)
+             {
+                 if (const auto stats = DecodeSysStatsResponse(message); stats)
+                     emit OnSysStatsReceived(*stats);
+                 else
+                     emit OnError(u"GetSysStats"_qs, u"Malformed response."_qs);
+             });
+    }
+
+    void StatsServiceClient::Call(const QString &method, const QByteArray &message, const std::function<void(const QByteArray &)> &handler)
+    {
+        if (runningCalls.contains(method))
+            return;
+
+        auto url = baseUrl;
+        url.setPath(QString::fromLatin1(GRPC_STATS_SERVICE) + method);
+
+        QNetworkRequest request{ url };
+        // gRPC servers of the kernels accept cleartext HTTP/2 with prior knowledge only.
+        request.setAttribute(QNetworkRequest::Http2DirectAttribute, true);
+        request.setHeader(QNetworkRequest::ContentTypeHeader, u"application/grpc"_qs);
+        request.setRawHeader("te", "trailers");
+        request.setTransferTimeout(5000);
+
+        runningCalls.insert(method);
+        const auto reply = manager.post(request, FrameMessage(message));
+        connect(reply, &QNetworkReply::finished, this,
+                [this, reply, method, handler]()
+                {
+                    reply->deleteLater();
+                    runningCalls.remove(method);
+
+                    if (reply->error() != QNetworkReply::NoError)
+                        return emit OnError(method, reply->errorString());
+
+                    // The status is sent in the trailers, or in the headers of a response without a message.
+                    const auto status = GetTrailer(reply, "grpc-status");
+                    if (!status)
+                        return emit OnError(method, u"Missing gRPC status."_qs);
+                    if (*status != "0")
+                        return emit OnError(method, u"gRPC status "_qs + QString::fromLatin1(*status) + u' ' +
+                                                        QString::fromUtf8(QByteArray::fromPercentEncoding(GetTrailer(reply, "grpc-message").value_or(QByteArray{}))));
+
+                    const auto response = UnframeMessage(reply->readAll());
+                    if (!response)
+                        return emit OnError(method, u"Malformed gRPC message."_qs);
+                    handler(*response);
+                });
+    }
+
+    QByteArray StatsServiceClient::EncodeQueryStatsRequest(const QString &pattern, bool reset)
+    {
+        QByteArray message;
+        // Default values are not serialized in proto3.
+        if (!pattern.isEmpty())
+        {
+            const auto bytes = pattern.toUtf8();
+            WriteVarint(message, (1 << 3) | WIRE_LENGTH_DELIMITED);
+            WriteVarint(message, bytes.size());
+            message.append(bytes);
+        }
+        if (reset)
+        {
+            WriteVarint(message, (2 << 3) | WIRE_VARINT);
+            WriteVarint(message, 1);
+        }
+        return message;
+    }
+
+    std::optional<StatsServiceClient::StatList> StatsServiceClient::DecodeQueryStatsResponse(const QByteArray &message)
+    {
+        StatList stats;
+        ProtobufReader reader{ message };
+        quint32 field, wireType;
+        while (!reader.AtEnd())
+        {
+            if (!reader.ReadTag(field, wireType))
+                return std::nullopt;
+
+            if (field == 1 && wireType == WIRE_LENGTH_DELIMITED)
+            {
+                QByteArrayView statMessage;
+                if (!reader.ReadBytes(statMessage))
+                    return std::nullopt;
+                const auto stat = DecodeStat(statMessage);
+                if (!stat)
+                    return std::nullopt;
+                stats << *stat;
+            }
+            else if (!reader.Skip(wireType))
+                return std::nullopt;
+        }
+        return stats;
+    }
+
+    std::optional<StatsServiceClient::SysStats> StatsServiceClient::DecodeSysStatsResponse(const QByteArray &message)
+    {
+        SysStats stats;
+        ProtobufReader reader{ message };
+        quint32 field, wireType;
+        while (!reader.AtEnd())
+        {
+            if (!reader.ReadTag(field, wireType))
+                return std::nullopt;
+
+            if (wireType != WIRE_VARINT)
+            {
+                if (!reader.Skip(wireType))
+                    return std::nullopt;
+                continue;
+            }
+
+            quint64 value;
+            if (!reader.ReadVarint(value))
+                return std::nullopt;
+
+            switch (field)
+            {
+                case 1: stats.numGoroutine = quint32(value); break;
+                case 2: stats.numGC = quint32(value); break;
+                case 3: stats.alloc = value; break;
+                case 4: stats.totalAlloc = value; break;
+                case 5: stats.sys = value; break;
+                case 6: stats.mallocs = value; break;
+                case 7: stats.frees = value; break;
+                case 8: stats.liveObjects = value; break;
+                case 9: stats.pauseTotalNs = value; break;
+                case 10: stats.uptime = quint32(value); break;
+                default: break;
+            }
+        }
+        return stats;
+    }
+
+    QByteArray StatsServiceClient::FrameMessage(const QByteArray &message)
+    {
+        QByteArray framed(GRPC_MESSAGE_PREFIX_SIZE, Qt::Uninitialized);
+        framed[0] = 0;
+        qToBigEndian<quint32>(quint32(message.size()), framed.data() + 1);
+        return framed.append(message);
+    }
+
+    std::optional<QByteArray> StatsServiceClient::UnframeMessage(const QByteArray &body)
+    {
+        // Unary calls carry exactly one message, compressed messages are never requested.
+        if (body.size() < GRPC_MESSAGE_PREFIX_SIZE || body[0] != 0)
+            return std::nullopt;
+        const auto length = qFromBigEndian<quint32>(body.constData() + 1);
+        if (length > quint64(body.size() - GRPC_MESSAGE_PREFIX_SIZE))
+            return std::nullopt;
+        return body.mid(GRPC_MESSAGE_PREFIX_SIZE, length);
+    }
+} // namespace Qv2rayBase::Profile
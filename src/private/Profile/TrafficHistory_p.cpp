@@ -0,0 +1,169 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/TrafficHistory_p.hpp"
+
+#include <QDataStream>
+#include <QIODevice>
+#include <algorithm>
+#include <cmath>
+
+namespace Qv2rayBase::Profile
+{
+    constexpr static quint8 TRAFFIC_HISTORY_FORMAT_VERSION = 1;
+
+    static std::array<quint64, 4> ToValues(const StatisticsObject &s)
+    {
+        return { static_cast<quint64>(s.proxyUp), static_cast<quint64>(s.proxyDown), static_cast<quint64>(s.directUp), static_cast<quint64>(s.directDown) };
+    }
+
+    static StatisticsObject FromValues(const std::array<quint64, 4> &v)
+    {
+        StatisticsObject s;
+        s.proxyUp = v[0];
+        s.proxyDown = v[1];
+        s.directUp = v[2];
+        s.directDown = v[3];
+        return s;
+    }
+
+    void TrafficHistory::Append(const StatisticsObject &delta, qint64 msecsSinceEpoch)
+    {
+        const auto values = ToValues(delta);
+        const auto seconds = msecsSinceEpoch / 1000;
+
+        for (auto r = 0; r < ResolutionCount; r++)
+        {
+            auto &ring = rings[r];
+            if (ring.isEmpty())
+                ring.resize(BucketCount[r]);
+
+            const auto bucketTime = seconds - seconds % BucketSeconds[r];
+            auto &bucket = ring[(bucketTime / BucketSeconds[r]) % BucketCount[r]];
+            if (bucket.time != bucketTime)
+                bucket = Bucket{ bucketTime, {} };
+
+            for (auto i = 0; i < 4; i++)
+                bucket.values[i] += values[i];
+        }
+
+        // The first sample has no interval, take it as one second worth of traffic.
+        const auto elapsed = lastUpdate == 0 ? 1.0 : std::max(0.001, (msecsSinceEpoch - lastUpdate) / 1000.0);
+        const auto alpha = 1.0 - std::exp(-elapsed / RateTimeConstant);
+        for (auto i = 0; i < 4; i++)
+            rates[i] += alpha * (values[i] / elapsed - rates[i]);
+        lastUpdate = msecsSinceEpoch;
+    }
+
+    QList<StatisticsObject> TrafficHistory::History(TrafficHistoryResolution resolution, qint64 msecsSinceEpoch) const
+    {
+        const auto r = static_cast<int>(resolution);
+        const auto &ring = rings[r];
+        const auto seconds = msecsSinceEpoch / 1000;
+        const auto latestBucket = seconds - seconds % BucketSeconds[r];
+
+        QList<StatisticsObject> result;
+        result.reserve(BucketCount[r]);
+        for (auto i = BucketCount[r] - 1; i >= 0; i--)
+        {
+            const auto bucketTime = latestBucket - i * BucketSeconds[r];
+            if (ring.isEmpty() || bucketTime < 0)
+            {
+                result << StatisticsObject{};
+                continue;
+            }
+            const auto &bucket = ring[(bucketTime / BucketSeconds[r]) % BucketCount[r]];
+            result << (bucket.time == bucketTime ? FromValues(bucket.values) : StatisticsObject{});
+        }
+        return result;
+    }
+
+    StatisticsObject TrafficHistory::Rate(qint64 msecsSinceEpoch) const
+    {
+        if (lastUpdate == 0)
+            return {};
+
+        // Decay the average when no sample has arrived since the last update.
+        const auto idle = std::max(0.0, (msecsSinceEpoch - lastUpdate) / 1000.0 - 1.0);
+        const auto decay = std::exp(-idle / RateTimeConstant);
+
+        std::array<quint64, 4> values;
+        for (auto i = 0; i < 4; i++)
+            values[i] = static_cast<quint64>(std::llround(rates[i] * decay));
+        return FromValues(values);
+    }
+
+    QByteArray TrafficHistory::Serialize() const
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << TRAFFIC_HISTORY_FORMAT_VERSION << lastUpdate;
+        for (const auto &rate : rates)
+            stream << rate;
+
+        for (const auto &ring : rings)
+        {
+            const auto used = std::count_if(ring.begin(), ring.end(), [](const Bucket &b) { return b.time != 0; });
+            stream << static_cast<quint32>(used);
+            for (const auto &bucket : ring)
+            {
+                if (bucket.time == 0)
+                    continue;
+                stream << bucket.time;
+                for (const auto &value : bucket.values)
+                    stream << value;
+            }
+        }
+        return qCompress(data);
+    }
+
+    TrafficHistory TrafficHistory::Deserialize(const QByteArray &compressed)
+    {
+        TrafficHistory history;
+        const auto data = qUncompress(compressed);
+        if (data.isEmpty())
+            return history;
+
+        QDataStream stream(data);
+        quint8 version = 0;
+        stream >> version;
+        if (version != TRAFFIC_HISTORY_FORMAT_VERSION)
+            return history;
+
+        stream >> history.lastUpdate;
+        for (auto &rate : history.rates)
+            stream >> rate;
+
+        for (auto r = 0; r < ResolutionCount; r++)
+        {
+            auto &ring = history.rings[r];
+            ring.resize(BucketCount[r]);
+
+            quint32 used = 0;
+            stream >> used;
+            for (quint32 i = 0; i < used && stream.status() == QDataStream::Ok; i++)
+            {
+                Bucket bucket;
+                stream >> bucket.time;
+                for (auto &value : bucket.values)
+                    stream >> value;
+                if (bucket.time > 0)
+                    ring[(bucket.time / BucketSeconds[r]) % BucketCount[r]] = bucket;
+            }
+        }
+        return history;
+    }
+} // namespace Qv2rayBase::Profile
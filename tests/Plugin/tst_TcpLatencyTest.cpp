@@ -0,0 +1,196 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "Qv2rayBase/Plugin/LatencyTestHost.hpp"
+#include "Qv2rayBase/private/Plugin/TcpLatencyTest_p.hpp"
+
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest>
+#include <atomic>
+#include <thread>
+
+using namespace Qv2rayPlugin::Latency;
+
+class TcpLatencyTestTest : public QObject
+{
+    Q_OBJECT
+  public:
+    TcpLatencyTestTest(QObject *parent = nullptr) : QObject(parent){};
+
+#ifndef QV2RAYBASE_NO_LIBUV
+  private:
+    static LatencyTestRequest Request(const QString &host, quint16 port)
+    {
+        return LatencyTestRequest{ Qv2rayBase::Plugin::BuiltinTcpLatencyTestEngineId, {}, host, port };
+    }
+
+    // The loop returns once the test has finished, the kernel accepts connections into the backlog without the event loop running.
+    static std::optional<LatencyTestResponse> Run(const LatencyTestRequest &request, int samples, int timeout)
+    {
+        const auto loop = uvw::Loop::create();
+        std::optional<LatencyTestResponse> result;
+        Qv2rayBase::Plugin::TcpLatencyTest::Start(loop, request, samples, timeout, [&result](const LatencyTestResponse &resp) { result = resp; });
+        loop->run();
+        loop->close();
+        return result;
+    }
+
+    static quint16 ClosedPort()
+    {
+        QTcpServer server;
+        if (!server.listen(QHostAddress::LocalHost))
+            return 0;
+        const auto port = server.serverPort();
+        server.close();
+        return port;
+    }
+
+  private slots:
+    void testOpenPort()
+    {
+        QTcpServer server;
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+
+        const auto resp = Run(Request(u"127.0.0.1"_qs, server.serverPort()), 3, 1000);
+        QVERIFY(resp);
+        QCOMPARE(resp->total, 3);
+        QCOMPARE(resp->succeeded, 3);
+        QCOMPARE(resp->failed, 0);
+        QVERIFY(resp->error.isEmpty());
+        QVERIFY(resp->min >= 0);
+        QVERIFY(resp->min <= resp->avg);
+        QVERIFY(resp->avg <= resp->max);
+    }
+
+    void testClosedPort()
+    {
+        const auto port = ClosedPort();
+        QVERIFY(port != 0);
+
+        const auto resp = Run(Request(u"127.0.0.1"_qs, port), 2, 1000);
+        QVERIFY(resp);
+        QCOMPARE(resp->total, 2);
+        QCOMPARE(resp->succeeded, 0);
+        QCOMPARE(resp->failed, 2);
+        QVERIFY(!resp->error.isEmpty());
+        QCOMPARE(resp->avg, LATENCY_TEST_VALUE_ERROR);
+        QCOMPARE(resp->min, LATENCY_TEST_VALUE_ERROR);
+        QCOMPARE(resp->max, LATENCY_TEST_VALUE_ERROR);
+    }
+
+    void testConcurrent()
+    {
+        // Many targets share one loop, the server accepts on this thread while the loop runs on another one.
+        constexpr auto ProbeCount = 256;
+        QTcpServer server;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+        server.setListenBacklogSize(ProbeCount);
+#endif
+        server.setMaxPendingConnections(ProbeCount);
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        connect(&server, &QTcpServer::newConnection, &server,
+                [&server]()
+                {
+                    while (const auto socket = server.nextPendingConnection())
+                        socket->close(), socket->deleteLater();
+                });
+
+        const auto loop = uvw::Loop::create();
+        std::vector<LatencyTestResponse> responses;
+        for (auto i = 0; i < ProbeCount; i++)
+            Qv2rayBase::Plugin::TcpLatencyTest::Start(loop, Request(u"127.0.0.1"_qs, server.serverPort()), 2, 5000,
+                                                      [&responses](const LatencyTestResponse &resp) { responses.push_back(resp); });
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        std::atomic_bool finished = false;
+        std::thread runner{ [&]() { loop->run(), finished = true; } };
+
+        // Every sample times out after 5 seconds at the latest, the loop always returns.
+        while (!finished)
+            QTest::qWait(10);
+        runner.join();
+        loop->close();
+        qInfo() << ProbeCount << "concurrent tests finished in" << elapsed.elapsed() << "ms.";
+
+        QCOMPARE(responses.size(), std::size_t{ ProbeCount });
+        for (const auto &resp : responses)
+        {
+            QCOMPARE(resp.total, 2);
+            QCOMPARE(resp.succeeded, 2);
+            QCOMPARE(resp.failed, 0);
+            QVERIFY(resp.error.isEmpty());
+            QVERIFY(resp.min >= 0);
+            QVERIFY(resp.avg < LATENCY_TEST_VALUE_ERROR);
+        }
+        QVERIFY(elapsed.elapsed() < 10000);
+    }
+
+    void testTimeout()
+    {
+        // A non-routable address, the SYN is never answered.
+        QElapsedTimer timer;
+        timer.start();
+        const auto resp = Run(Request(u"10.255.255.1"_qs, 80), 2, 200);
+        QVERIFY(resp);
+        if (resp->error != u"Connection timed out."_qs)
+            QSKIP("The address is rejected by the network instead of being dropped.");
+
+        QCOMPARE(resp->succeeded, 0);
+        QCOMPARE(resp->failed, 2);
+        QCOMPARE(resp->avg, LATENCY_TEST_VALUE_ERROR);
+        QVERIFY(timer.elapsed() >= 400);
+        QVERIFY(timer.elapsed() < 5000);
+    }
+
+    void testCancel()
+    {
+        // Cancelling closes the handles so that the loop returns at once, without delivering a result.
+        const auto loop = uvw::Loop::create();
+        bool called = false;
+        const auto test = Qv2rayBase::Plugin::TcpLatencyTest::Start(loop, Request(u"10.255.255.1"_qs, 80), 3, 30000,
+                                                                    [&called](const LatencyTestResponse &) { called = true; });
+        const auto timer = loop->resource<uvw::TimerHandle>();
+        timer->once<uvw::TimerEvent>(
+            [test](const uvw::TimerEvent &, uvw::TimerHandle &t)
+            {
+                test->Cancel();
+                t.close();
+            });
+        timer->start(uvw::TimerHandle::Time{ 100 }, uvw::TimerHandle::Time{ 0 });
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+        loop->run();
+        loop->close();
+        if (called)
+            QSKIP("The address is rejected by the network instead of being dropped.");
+        QVERIFY(elapsed.elapsed() < 5000);
+    }
+#else
+  private slots:
+    void testUnsupported()
+    {
+        QSKIP("The built-in latency test requires libuv.");
+    }
+#endif
+};
+
+QTEST_MAIN(TcpLatencyTestTest)
+#include "tst_TcpLatencyTest.moc"
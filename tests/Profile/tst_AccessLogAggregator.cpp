@@ -0,0 +1,126 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/AccessLogAggregator_p.hpp"
+
+#include <QtTest>
+#include <limits>
+
+using namespace Qv2rayBase::Profile;
+
+using CountList = QList<std::pair<QString, quint64>>;
+
+class AccessLogAggregatorTest : public QObject
+{
+    Q_OBJECT
+  public:
+    AccessLogAggregatorTest(QObject *parent = nullptr) : QObject(parent){};
+
+  private slots:
+    void testParse_data()
+    {
+        QTest::addColumn<QString>("line");
+        QTest::addColumn<bool>("accepted");
+        QTest::addColumn<QString>("source");
+        QTest::addColumn<QString>("destination");
+        QTest::addColumn<QString>("inboundTag");
+        QTest::addColumn<QString>("outboundTag");
+
+        QTest::newRow("v2ray") << u"2021/01/01 00:00:00 127.0.0.1:51234 accepted tcp:example.com:443 [socks >> proxy]"_qs //
+                               << true << u"127.0.0.1:51234"_qs << u"example.com"_qs << u"socks"_qs << u"proxy"_qs;
+        QTest::newRow("xray") << u"2021/01/01 00:00:00 from 127.0.0.1:51234 accepted udp:8.8.8.8:53 [dns-in -> direct]"_qs //
+                              << true << u"127.0.0.1:51234"_qs << u"8.8.8.8"_qs << u"dns-in"_qs << u"direct"_qs;
+        QTest::newRow("ipv6") << u"2021/01/01 00:00:00 [::1]:51234 accepted tcp:[2001:db8::1]:80 [http >> proxy]"_qs //
+                              << true << u"[::1]:51234"_qs << u"2001:db8::1"_qs << u"http"_qs << u"proxy"_qs;
+        QTest::newRow("no-network") << u"2021/01/01 00:00:00 127.0.0.1:51234 accepted example.org:80"_qs //
+                                    << true << u"127.0.0.1:51234"_qs << u"example.org"_qs << QString{} << QString{};
+        QTest::newRow("inbound-only") << u"2021/01/01 00:00:00 127.0.0.1:51234 accepted tcp:example.org:80 [socks]"_qs //
+                                      << true << u"127.0.0.1:51234"_qs << u"example.org"_qs << u"socks"_qs << QString{};
+        QTest::newRow("rejected") << u"2021/01/01 00:00:00 127.0.0.1:51234 rejected  proxy/socks: unknown command"_qs //
+                                  << false << u"127.0.0.1:51234"_qs << QString{} << QString{} << QString{};
+    }
+
+    void testParse()
+    {
+        QFETCH(QString, line);
+        QFETCH(bool, accepted);
+        QFETCH(QString, source);
+        QFETCH(QString, destination);
+        QFETCH(QString, inboundTag);
+        QFETCH(QString, outboundTag);
+
+        AccessLogEntry entry;
+        QVERIFY(AccessLogAggregator::Parse(line, entry));
+        QCOMPARE(entry.accepted, accepted);
+        QCOMPARE(entry.source.toString(), source);
+        QCOMPARE(entry.destination.toString(), destination);
+        QCOMPARE(entry.inboundTag.toString(), inboundTag);
+        QCOMPARE(entry.outboundTag.toString(), outboundTag);
+    }
+
+    void testParseOtherLines()
+    {
+        AccessLogEntry entry;
+        QVERIFY(!AccessLogAggregator::Parse(u"2021/01/01 00:00:00 [Info] v2ray.com/core: V2Ray 4.45.0 started", entry));
+        QVERIFY(!AccessLogAggregator::Parse(u"", entry));
+    }
+
+    void testAggregate()
+    {
+        AccessLogAggregator aggregator;
+        for (auto i = 0; i < 3; i++)
+            aggregator.Add(u"2021/01/01 00:00:00 127.0.0.1:1 accepted tcp:a.com:443 [socks >> proxy]");
+        for (auto i = 0; i < 2; i++)
+            aggregator.Add(u"2021/01/01 00:00:00 127.0.0.1:1 accepted tcp:b.com:443 [socks >> direct]");
+        aggregator.Add(u"2021/01/01 00:00:00 127.0.0.1:1 accepted tcp:c.com:443 [socks >> proxy]");
+        aggregator.Add(u"2021/01/01 00:00:00 127.0.0.1:1 rejected  proxy/socks: unknown command");
+        aggregator.Add(u"2021/01/01 00:00:00 [Warning] something else");
+
+        QCOMPARE(aggregator.Accepted(), 6ULL);
+        QCOMPARE(aggregator.Rejected(), 1ULL);
+        QCOMPARE(aggregator.TopDestinations(2), (CountList{ { u"a.com"_qs, 3 }, { u"b.com"_qs, 2 } }));
+        QCOMPARE(aggregator.TopDestinations(10).size(), 3);
+        QCOMPARE(aggregator.TopOutbounds(10), (CountList{ { u"proxy"_qs, 4 }, { u"direct"_qs, 2 } }));
+        QVERIFY(aggregator.TopOutbounds(0).isEmpty());
+        QVERIFY(aggregator.TopOutbounds(-1).isEmpty());
+
+        aggregator.Clear();
+        QCOMPARE(aggregator.Accepted(), 0ULL);
+        QCOMPARE(aggregator.Rejected(), 0ULL);
+        QVERIFY(aggregator.TopDestinations(10).isEmpty());
+        QVERIFY(aggregator.TopOutbounds(10).isEmpty());
+    }
+
+    void testDestinationOverflow()
+    {
+        AccessLogAggregator aggregator;
+        const auto distinct = AccessLogAggregator::MaxDestinations + 10;
+        for (auto i = 0; i < distinct; i++)
+            aggregator.Add(u"2021/01/01 00:00:00 127.0.0.1:1 accepted tcp:host%1.com:443 [socks >> proxy]"_qs.arg(i));
+
+        // Known destinations are still counted, new ones go into the bucket of others.
+        aggregator.Add(u"2021/01/01 00:00:00 127.0.0.1:1 accepted tcp:host0.com:443 [socks >> proxy]");
+
+        const auto top = aggregator.TopDestinations(std::numeric_limits<int>::max());
+        QCOMPARE(top.size(), AccessLogAggregator::MaxDestinations + 1);
+        QCOMPARE(top.first(), (std::pair{ AccessLogAggregator::OtherDestinations, quint64(10) }));
+        QCOMPARE(top.at(1), (std::pair{ u"host0.com"_qs, quint64(2) }));
+        QCOMPARE(aggregator.Accepted(), quint64(distinct + 1));
+    }
+};
+
+QTEST_MAIN(AccessLogAggregatorTest)
+#include "tst_AccessLogAggregator.moc"
@@ -0,0 +1,156 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/ConnectionIndex_p.hpp"
+#include "QvPlugin/Handlers/LatencyTestHandler.hpp"
+
+#include <QtTest>
+
+using namespace Qv2rayBase::Profile;
+
+class ConnectionIndexTest : public QObject
+{
+    Q_OBJECT
+  public:
+    ConnectionIndexTest(QObject *parent = nullptr) : QObject(parent){};
+
+  private:
+    static ConnectionObject MakeConnection(const QString &name, const QStringList &tags = {}, int latency = 0)
+    {
+        ConnectionObject object;
+        object.name = name;
+        object.tags = { tags.begin(), tags.end() };
+        object.latency = latency;
+        return object;
+    }
+
+    static ProfileContent MakeProfile(const QString &protocol, const QString &host, int port)
+    {
+        OutboundObject out;
+        out.outboundSettings.protocol = protocol;
+        out.outboundSettings.address = host;
+        out.outboundSettings.port = port;
+        ProfileContent root;
+        root.outbounds << out;
+        return root;
+    }
+
+    static QSet<ConnectionId> Query(const ConnectionIndex &index, const QString &query, const QHash<ConnectionId, ConnectionObject> &connections)
+    {
+        const auto result = index.Query(query, connections);
+        return { result.begin(), result.end() };
+    }
+
+  private slots:
+    void init()
+    {
+        index.Clear();
+        connections.clear();
+        connections.insert(hk, MakeConnection(u"Hong Kong 01"_qs, { u"Fast"_qs }, 80));
+        connections.insert(jp, MakeConnection(u"Japan-Tokyo 01"_qs, { u"fast"_qs, u"Game"_qs }, 150));
+        connections.insert(us, MakeConnection(u"US West"_qs, {}, 300));
+        index.Update(hk, connections[hk], MakeProfile(u"vmess"_qs, u"hk.example.com"_qs, 443));
+        index.Update(jp, connections[jp], MakeProfile(u"Shadowsocks"_qs, u"JP.example.com"_qs, 8388));
+        index.Update(us, connections[us], MakeProfile(u"vmess"_qs, u"us.example.com"_qs, 443));
+    }
+
+    void testTokenize()
+    {
+        QCOMPARE(ConnectionIndex::Tokenize(u"Japan-Tokyo 01, japan"_qs), (QStringList{ u"japan"_qs, u"tokyo"_qs, u"01"_qs }));
+        QCOMPARE(ConnectionIndex::Tokenize(u" -- "_qs), QStringList{});
+    }
+
+    void testTokenQueries()
+    {
+        QCOMPARE(Query(index, u"01"_qs, connections), (QSet{ hk, jp }));
+        QCOMPARE(Query(index, u"TOKYO 01"_qs, connections), (QSet{ jp }));
+        QCOMPARE(Query(index, u"name:west"_qs, connections), (QSet{ us }));
+        QCOMPARE(Query(index, u"tag:fast"_qs, connections), (QSet{ hk, jp }));
+        QCOMPARE(Query(index, u"tag:fast tag:game"_qs, connections), (QSet{ jp }));
+        QCOMPARE(Query(index, u"protocol:shadowsocks"_qs, connections), (QSet{ jp }));
+        QCOMPARE(Query(index, u"host:jp.example.com"_qs, connections), (QSet{ jp }));
+        QCOMPARE(Query(index, u"port:443"_qs, connections), (QSet{ hk, us }));
+        QCOMPARE(Query(index, u"port:443 tag:fast"_qs, connections), (QSet{ hk }));
+        QCOMPARE(Query(index, u"korea"_qs, connections), QSet<ConnectionId>{});
+    }
+
+    void testLatencyFilters()
+    {
+        QCOMPARE(Query(index, u"latency<150"_qs, connections), (QSet{ hk }));
+        QCOMPARE(Query(index, u"latency<=150"_qs, connections), (QSet{ hk, jp }));
+        QCOMPARE(Query(index, u"latency>=150 protocol:vmess"_qs, connections), (QSet{ us }));
+        QCOMPARE(Query(index, u"latency=300"_qs, connections), (QSet{ us }));
+        QCOMPARE(Query(index, u"latency<abc"_qs, connections), QSet<ConnectionId>{});
+    }
+
+    void testLatencyFiltersSkipUntested()
+    {
+        connections.insert(untested, MakeConnection(u"Untested"_qs, {}, LATENCY_TEST_VALUE_NODATA));
+        connections.insert(failed, MakeConnection(u"Failed"_qs, {}, LATENCY_TEST_VALUE_ERROR));
+        connections.insert(negative, MakeConnection(u"Negative"_qs, {}, -1));
+        index.Update(untested, connections[untested], MakeProfile(u"vmess"_qs, u"untested.example.com"_qs, 443));
+        index.Update(failed, connections[failed], MakeProfile(u"vmess"_qs, u"failed.example.com"_qs, 443));
+        index.Update(negative, connections[negative], MakeProfile(u"vmess"_qs, u"negative.example.com"_qs, 443));
+
+        QCOMPARE(Query(index, u"latency>100"_qs, connections), (QSet{ jp, us }));
+        QCOMPARE(Query(index, u"latency>=80"_qs, connections), (QSet{ hk, jp, us }));
+        QCOMPARE(Query(index, u"latency<100"_qs, connections), (QSet{ hk }));
+        QCOMPARE(Query(index, u"latency=-1"_qs, connections), QSet<ConnectionId>{});
+        QCOMPARE(Query(index, u"latency=%1"_qs.arg(LATENCY_TEST_VALUE_NODATA), connections), QSet<ConnectionId>{});
+        QCOMPARE(Query(index, u"latency>=0 port:443"_qs, connections), (QSet{ hk, us }));
+    }
+
+    void testRename()
+    {
+        connections[hk].name = u"Singapore 02"_qs;
+        index.Update(hk, connections[hk], MakeProfile(u"trojan"_qs, u"sg.example.com"_qs, 443));
+
+        QCOMPARE(Query(index, u"kong"_qs, connections), QSet<ConnectionId>{});
+        QCOMPARE(Query(index, u"01"_qs, connections), (QSet{ jp }));
+        QCOMPARE(Query(index, u"singapore"_qs, connections), (QSet{ hk }));
+        QCOMPARE(Query(index, u"protocol:vmess"_qs, connections), (QSet{ us }));
+        QCOMPARE(Query(index, u"protocol:trojan"_qs, connections), (QSet{ hk }));
+        QCOMPARE(Query(index, u"host:hk.example.com"_qs, connections), QSet<ConnectionId>{});
+    }
+
+    void testRemove()
+    {
+        index.Remove(jp);
+        connections.remove(jp);
+
+        QCOMPARE(Query(index, u"01"_qs, connections), (QSet{ hk }));
+        QCOMPARE(Query(index, u"tag:game"_qs, connections), QSet<ConnectionId>{});
+        QCOMPARE(Query(index, u"port:8388"_qs, connections), QSet<ConnectionId>{});
+
+        // Removing twice is harmless.
+        index.Remove(jp);
+        QCOMPARE(Query(index, u"tag:fast"_qs, connections), (QSet{ hk }));
+    }
+
+  private:
+    const ConnectionId hk{ u"hk"_qs };
+    const ConnectionId jp{ u"jp"_qs };
+    const ConnectionId us{ u"us"_qs };
+    const ConnectionId untested{ u"untested"_qs };
+    const ConnectionId failed{ u"failed"_qs };
+    const ConnectionId negative{ u"negative"_qs };
+    ConnectionIndex index;
+    QHash<ConnectionId, ConnectionObject> connections;
+};
+
+QTEST_MAIN(ConnectionIndexTest)
+
+#include "tst_ConnectionIndex.moc"
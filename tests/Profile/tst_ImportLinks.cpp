@@ -0,0 +1,152 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/Profile/ProfileManager.hpp"
+#include "Qv2rayBase/Qv2rayBaseLibrary.hpp"
+#include "QvPlugin/PluginInterface.hpp"
+#include "TestCommon.hpp"
+
+#include <QtTest>
+
+// Decodes "test://host:port#name" links.
+class TestOutboundHandler : public Qv2rayPlugin::Outbound::IOutboundProcessor
+{
+  public:
+    std::optional<PluginIOBoundData> GetOutboundInfo(const IOConnectionSettings &) const override
+    {
+        return std::nullopt;
+    }
+    bool SetOutboundInfo(IOConnectionSettings &, const PluginIOBoundData &) const override
+    {
+        return false;
+    }
+    std::optional<QString> Serialize(const QString &, const IOConnectionSettings &) const override
+    {
+        return std::nullopt;
+    }
+    std::optional<std::pair<QString, IOConnectionSettings>> Deserialize(const QString &link) const override
+    {
+        const QUrl url{ link };
+        if (!url.isValid() || url.host().isEmpty() || url.port() <= 0)
+            return std::nullopt;
+
+        IOConnectionSettings settings;
+        settings.protocol = u"test"_qs;
+        settings.address = url.host();
+        settings.port = url.port();
+        return std::pair{ url.fragment(), settings };
+    }
+    QList<QString> SupportedLinkPrefixes() const override
+    {
+        return { u"test://"_qs };
+    }
+    QList<QString> SupportedProtocols() const override
+    {
+        return { u"test"_qs };
+    }
+};
+
+class TestLinkPlugin
+    : public QObject
+    , public Qv2rayPlugin::Qv2rayInterface<TestLinkPlugin>
+{
+    Q_OBJECT
+    QV2RAY_PLUGIN(TestLinkPlugin)
+  public:
+    virtual const Qv2rayPlugin::QvPluginMetadata GetMetadata() const override
+    {
+        return Qv2rayPlugin::QvPluginMetadata{ u"Share Link Import Test Plugin"_qs, //
+                                               u"Moody"_qs,                         //
+                                               PluginId(u"import_links_test"_qs),
+                                               u""_qs,
+                                               u""_qs,
+                                               { Qv2rayPlugin::COMPONENT_OUTBOUND_HANDLER } };
+    }
+    virtual bool InitializePlugin() override
+    {
+        m_OutboundHandler = std::make_shared<TestOutboundHandler>();
+        return true;
+    }
+    virtual void SettingsUpdated() override{};
+};
+
+class ImportLinksTest : public QObject
+{
+    Q_OBJECT
+  public:
+    ImportLinksTest(QObject *parent = nullptr) : QObject(parent){};
+
+  private slots:
+    void initTestCase()
+    {
+        baselib = new Qv2rayBase::Qv2rayBaseLibrary;
+        baselib->Initialize({}, {}, new Qv2rayBase::Tests::UIInterface);
+    }
+
+    void testMixedLinks()
+    {
+        const auto group = baselib->ProfileManager()->CreateGroup(u"Import Test"_qs);
+        const QStringList links{
+            u"test://a.example.com:443#A"_qs,
+            u"garbage"_qs,
+            u"  "_qs,
+            u"test://b.example.com:443#B"_qs,
+            u"test://a.example.com:443#A again"_qs,
+            u"garbage"_qs,
+            u"test://no-port.example.com#C"_qs,
+        };
+
+        const auto &[created, errors] = baselib->ProfileManager()->ImportLinks(links, group);
+        QCOMPARE(created.size(), 2);
+        QCOMPARE(baselib->ProfileManager()->GetConnections(group).size(), 2);
+        QCOMPARE(baselib->ProfileManager()->GetConnectionObject(created.at(0).connectionId).name, u"A"_qs);
+        QCOMPARE(baselib->ProfileManager()->GetConnectionObject(created.at(1).connectionId).name, u"B"_qs);
+
+        // Every failed link is reported at its own position, empty lines are skipped silently.
+        QCOMPARE(errors.keys(), (QList<int>{ 1, 4, 5, 6 }));
+
+        // Importing again only finds duplicates.
+        const auto &[createdAgain, errorsAgain] = baselib->ProfileManager()->ImportLinks({ links.at(0), links.at(3) }, group);
+        QVERIFY(createdAgain.isEmpty());
+        QCOMPARE(errorsAgain.keys(), (QList<int>{ 0, 1 }));
+
+        // Remove the imported connections from our own list, the group is empty when it's deleted.
+        for (const auto &conn : created)
+            baselib->ProfileManager()->RemoveFromGroup(conn.connectionId, group);
+        QVERIFY(baselib->ProfileManager()->GetConnections(group).isEmpty());
+        baselib->ProfileManager()->DeleteGroup(group, false);
+    }
+
+    void testInvalidGroup()
+    {
+        const auto &[created, errors] = baselib->ProfileManager()->ImportLinks({ u"test://a.example.com:443#A"_qs, u"garbage"_qs }, GroupId(u"nonexistent"_qs));
+        QVERIFY(created.isEmpty());
+        QCOMPARE(errors.keys(), (QList<int>{ 0, 1 }));
+    }
+
+    void cleanupTestCase()
+    {
+        delete baselib;
+    }
+
+  private:
+    Qv2rayBase::Qv2rayBaseLibrary *baselib;
+};
+
+QTEST_MAIN(ImportLinksTest)
+Q_IMPORT_PLUGIN(TestLinkPlugin)
+
+#include "tst_ImportLinks.moc"
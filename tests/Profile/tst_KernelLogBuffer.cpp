@@ -0,0 +1,113 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/KernelManager_p.hpp"
+
+#include <QtTest>
+
+using namespace Qv2rayBase::Profile;
+
+class KernelLogBufferTest : public QObject
+{
+    Q_OBJECT
+  public:
+    KernelLogBufferTest(QObject *parent = nullptr) : QObject(parent){};
+
+  private:
+    static void PushLines(KernelLogBuffer &buffer, int from, int to)
+    {
+        for (auto i = from; i < to; i++)
+            buffer.Push(QString::number(i));
+    }
+
+    static QStringList Lines(int from, int to)
+    {
+        QStringList lines;
+        for (auto i = from; i < to; i++)
+            lines << QString::number(i);
+        return lines;
+    }
+
+  private slots:
+    void testEmpty()
+    {
+        KernelLogBuffer buffer(4);
+        QVERIFY(buffer.IsEmpty());
+        QVERIFY(buffer.TakeAll().isEmpty());
+        QCOMPARE(buffer.TakeDropped(), 0ULL);
+    }
+
+    void testWithinCapacity()
+    {
+        KernelLogBuffer buffer(4);
+        PushLines(buffer, 0, 4);
+        QVERIFY(!buffer.IsEmpty());
+        QCOMPARE(buffer.TakeAll(), Lines(0, 4));
+        QCOMPARE(buffer.TakeDropped(), 0ULL);
+        QVERIFY(buffer.IsEmpty());
+        QVERIFY(buffer.TakeAll().isEmpty());
+    }
+
+    void testZeroCapacity()
+    {
+        // Treated as a capacity of one, only the latest line is kept.
+        for (const auto capacity : { 0, -1 })
+        {
+            KernelLogBuffer buffer(capacity);
+            PushLines(buffer, 0, 3);
+            QCOMPARE(buffer.TakeAll(), Lines(2, 3));
+            QCOMPARE(buffer.TakeDropped(), 2ULL);
+            QVERIFY(buffer.IsEmpty());
+        }
+    }
+
+    void testOverflow()
+    {
+        // The oldest lines are dropped and counted.
+        KernelLogBuffer buffer(4);
+        PushLines(buffer, 0, 11);
+        QCOMPARE(buffer.TakeAll(), Lines(7, 11));
+        QCOMPARE(buffer.TakeDropped(), 7ULL);
+        QCOMPARE(buffer.TakeDropped(), 0ULL);
+    }
+
+    void testWrapAround()
+    {
+        KernelLogBuffer buffer(4);
+        PushLines(buffer, 0, 3);
+        QCOMPARE(buffer.TakeAll(), Lines(0, 3));
+
+        // The ring restarts from the beginning after being drained.
+        PushLines(buffer, 3, 9);
+        QCOMPARE(buffer.TakeAll(), Lines(5, 9));
+        QCOMPARE(buffer.TakeDropped(), 2ULL);
+
+        PushLines(buffer, 9, 11);
+        QCOMPARE(buffer.TakeAll(), Lines(9, 11));
+        QCOMPARE(buffer.TakeDropped(), 0ULL);
+    }
+
+    void testSingleLine()
+    {
+        KernelLogBuffer buffer(1);
+        PushLines(buffer, 0, 3);
+        QCOMPARE(buffer.TakeAll(), Lines(2, 3));
+        QCOMPARE(buffer.TakeDropped(), 2ULL);
+    }
+};
+
+QTEST_MAIN(KernelLogBufferTest)
+#include "tst_KernelLogBuffer.moc"
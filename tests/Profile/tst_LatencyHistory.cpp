@@ -0,0 +1,164 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/LatencyHistory_p.hpp"
+#include "QvPlugin/Handlers/LatencyTestHandler.hpp"
+
+#include <QtTest>
+
+using namespace Qv2rayBase::Profile;
+
+class LatencyHistoryTest : public QObject
+{
+    Q_OBJECT
+  public:
+    LatencyHistoryTest(QObject *parent = nullptr) : QObject(parent){};
+
+  private slots:
+    void testEmpty()
+    {
+        LatencyHistory history;
+        QCOMPARE(history.Size(), 0);
+        QCOMPARE(history.FailedCount(), 0);
+        QCOMPARE(history.Percentile(50), -1);
+        QCOMPARE(history.Jitter(), 0);
+        QVERIFY(history.Serialize().isEmpty());
+    }
+
+    void testPercentile_data()
+    {
+        QTest::addColumn<int>("percent");
+        QTest::addColumn<int>("expected");
+
+        // Nearest rank over 10, 20, ..., 100.
+        QTest::newRow("p0") << 0 << 10;
+        QTest::newRow("p10") << 10 << 10;
+        QTest::newRow("p11") << 11 << 20;
+        QTest::newRow("p50") << 50 << 50;
+        QTest::newRow("p95") << 95 << 100;
+        QTest::newRow("p100") << 100 << 100;
+        QTest::newRow("p200") << 200 << 100;
+    }
+
+    void testPercentile()
+    {
+        QFETCH(int, percent);
+        QFETCH(int, expected);
+
+        LatencyHistory history;
+        for (const auto latency : { 70, 10, 100, 40, 30, 90, 20, 60, 50, 80 })
+            history.Push(latency);
+        QCOMPARE(history.Percentile(percent), expected);
+    }
+
+    void testFailedSamples()
+    {
+        LatencyHistory history;
+        history.Push(-1);
+        history.Push(-1);
+        QCOMPARE(history.Size(), 2);
+        QCOMPARE(history.FailedCount(), 2);
+        QCOMPARE(history.Percentile(95), -1);
+
+        // Failed samples are not part of the percentile.
+        history.Push(120);
+        history.Push(-1);
+        QCOMPARE(history.FailedCount(), 3);
+        QCOMPARE(history.Percentile(0), 120);
+        QCOMPARE(history.Percentile(100), 120);
+    }
+
+    void testZeroLatency()
+    {
+        // Loopback and LAN servers answer within the same millisecond.
+        QVERIFY(LatencyHistory::IsSuccessful(0));
+        QVERIFY(LatencyHistory::IsSuccessful(250));
+        QVERIFY(!LatencyHistory::IsSuccessful(-1));
+        QVERIFY(!LatencyHistory::IsSuccessful(LATENCY_TEST_VALUE_NODATA));
+        QVERIFY(!LatencyHistory::IsSuccessful(LATENCY_TEST_VALUE_ERROR));
+
+        LatencyHistory history;
+        history.Push(0);
+        history.Push(0);
+        QCOMPARE(history.FailedCount(), 0);
+        QCOMPARE(history.Percentile(95), 0);
+    }
+
+    void testClamp()
+    {
+        LatencyHistory history;
+        history.Push(1 << 20);
+        QCOMPARE(history.FailedCount(), 0);
+        QCOMPARE(history.Percentile(50), LatencyHistory::FailedSample - 1);
+    }
+
+    void testOverflow()
+    {
+        LatencyHistory history;
+        for (auto i = 0; i < LatencyHistory::Capacity; i++)
+            history.Push(-1);
+        for (auto i = 1; i <= LatencyHistory::Capacity / 2; i++)
+            history.Push(i);
+
+        // The oldest half of the failures has been overwritten.
+        QCOMPARE(history.Size(), LatencyHistory::Capacity);
+        QCOMPARE(history.FailedCount(), LatencyHistory::Capacity / 2);
+        QCOMPARE(history.Percentile(100), LatencyHistory::Capacity / 2);
+    }
+
+    void testJitter()
+    {
+        LatencyHistory history;
+        history.Push(100);
+        QCOMPARE(history.Jitter(), 0);
+
+        // |140-100| + |90-140| + |90-90| = 90 over 3 intervals, the failure is skipped.
+        history.Push(140);
+        history.Push(-1);
+        history.Push(90);
+        history.Push(90);
+        QCOMPARE(history.Jitter(), 30);
+    }
+
+    void testSerialize()
+    {
+        LatencyHistory history;
+        for (auto i = 0; i < LatencyHistory::Capacity + 5; i++)
+            history.Push(i % 7 == 0 ? -1 : i * 10);
+
+        const auto data = history.Serialize();
+        QCOMPARE(data.size(), LatencyHistory::Capacity * qsizetype(sizeof(quint16)));
+
+        const auto restored = LatencyHistory::Deserialize(data);
+        QCOMPARE(restored.Size(), history.Size());
+        QCOMPARE(restored.FailedCount(), history.FailedCount());
+        QCOMPARE(restored.Percentile(50), history.Percentile(50));
+        QCOMPARE(restored.Jitter(), history.Jitter());
+        QCOMPARE(restored.Serialize(), data);
+    }
+
+    void testDeserializeTruncated()
+    {
+        // Little-endian 300, 0xFFFF (failed) and a dangling byte.
+        const auto restored = LatencyHistory::Deserialize(QByteArray::fromHex("2c01ffff07"));
+        QCOMPARE(restored.Size(), 2);
+        QCOMPARE(restored.FailedCount(), 1);
+        QCOMPARE(restored.Percentile(50), 300);
+    }
+};
+
+QTEST_MAIN(LatencyHistoryTest)
+#include "tst_LatencyHistory.moc"
@@ -0,0 +1,373 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/StatsServiceClient_p.hpp"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+#include <QtTest>
+
+using namespace Qv2rayBase::Profile;
+
+namespace
+{
+    void WriteVarint(QByteArray &out, quint64 value)
+    {
+        while (value >= 0x80)
+        {
+            out.append(char((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.append(char(value));
+    }
+
+    QByteArray VarintField(quint32 field, quint64 value)
+    {
+        QByteArray out;
+        WriteVarint(out, (field << 3) | 0);
+        WriteVarint(out, value);
+        return out;
+    }
+
+    QByteArray BytesField(quint32 field, const QByteArray &bytes)
+    {
+        QByteArray out;
+        WriteVarint(out, (field << 3) | 2);
+        WriteVarint(out, bytes.size());
+        return out + bytes;
+    }
+
+    QByteArray StatMessage(const QByteArray &name, quint64 value)
+    {
+        return BytesField(1, name) + VarintField(2, value);
+    }
+} // namespace
+
+///
+/// \brief A gRPC server answering every unary call with the same response, over cleartext HTTP/2 with prior knowledge.
+/// Request headers are not decoded, the responses are encoded with HPACK literals only.
+///
+class GrpcStubServer : public QTcpServer
+{
+    Q_OBJECT
+  public:
+    struct Response
+    {
+        QByteArray message;
+        QByteArray status = "0";
+        QByteArray statusMessage;
+        // Send the status in the headers, without a message, as servers do for failed calls.
+        bool trailersOnly = false;
+    };
+
+    Response response;
+    // Request bodies, as framed by the client.
+    QList<QByteArray> requests;
+
+    explicit GrpcStubServer(QObject *parent = nullptr) : QTcpServer(parent)
+    {
+        connect(this, &QTcpServer::newConnection, this, &GrpcStubServer::onNewConnection);
+    }
+
+  private:
+    enum FrameType : quint8
+    {
+        DATA = 0x0,
+        HEADERS = 0x1,
+        SETTINGS = 0x4,
+        PING = 0x6,
+    };
+    enum FrameFlag : quint8
+    {
+        ACK = 0x1,
+        END_STREAM = 0x1,
+        END_HEADERS = 0x4,
+    };
+
+    struct Connection
+    {
+        QByteArray buffer;
+        bool prefaceReceived = false;
+        QHash<quint32, QByteArray> bodies;
+    };
+
+    static QByteArray Frame(quint8 type, quint8 flags, quint32 stream, const QByteArray &payload)
+    {
+        QByteArray frame(9, Qt::Uninitialized);
+        frame[0] = char((payload.size() >> 16) & 0xFF);
+        frame[1] = char((payload.size() >> 8) & 0xFF);
+        frame[2] = char(payload.size() & 0xFF);
+        frame[3] = char(type);
+        frame[4] = char(flags);
+        qToBigEndian<quint32>(stream & 0x7FFFFFFF, frame.data() + 5);
+        return frame + payload;
+    }
+
+    static QByteArray Literal(const QByteArray &name, const QByteArray &value)
+    {
+        // Literal header field without indexing, new name, no Huffman coding (RFC 7541, section 6.2.2).
+        QByteArray field(1, '\0');
+        field.append(char(name.size())).append(name);
+        field.append(char(value.size())).append(value);
+        return field;
+    }
+
+    void onNewConnection()
+    {
+        while (const auto socket = nextPendingConnection())
+        {
+            connections.insert(socket, {});
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { connections.remove(socket), socket->deleteLater(); });
+            socket->write(Frame(SETTINGS, 0, 0, {}));
+        }
+    }
+
+    void onReadyRead(QTcpSocket *socket)
+    {
+        auto &connection = connections[socket];
+        connection.buffer += socket->readAll();
+
+        // The client connection preface: "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n".
+        if (!connection.prefaceReceived)
+        {
+            if (connection.buffer.size() < 24)
+                return;
+            connection.buffer.remove(0, 24);
+            connection.prefaceReceived = true;
+        }
+
+        while (connection.buffer.size() >= 9)
+        {
+            const auto length = (quint8(connection.buffer[0]) << 16) | (quint8(connection.buffer[1]) << 8) | quint8(connection.buffer[2]);
+            if (connection.buffer.size() < 9 + length)
+                return;
+
+            const auto type = quint8(connection.buffer[3]);
+            const auto flags = quint8(connection.buffer[4]);
+            const auto stream = qFromBigEndian<quint32>(connection.buffer.constData() + 5) & 0x7FFFFFFF;
+            const auto payload = connection.buffer.mid(9, length);
+            connection.buffer.remove(0, 9 + length);
+
+            switch (type)
+            {
+                case SETTINGS:
+                    if (!(flags & ACK))
+                        socket->write(Frame(SETTINGS, ACK, 0, {}));
+                    break;
+                case PING:
+                    if (!(flags & ACK))
+                        socket->write(Frame(PING, ACK, 0, payload));
+                    break;
+                case HEADERS:
+                    if (flags & END_STREAM)
+                        respond(socket, connection, stream);
+                    break;
+                case DATA:
+                    connection.bodies[stream] += payload;
+                    if (flags & END_STREAM)
+                        respond(socket, connection, stream);
+                    break;
+                default: break;
+            }
+        }
+    }
+
+    void respond(QTcpSocket *socket, Connection &connection, quint32 stream)
+    {
+        requests << connection.bodies.take(stream);
+
+        // Indexed ":status: 200" from the static table.
+        const auto headers = QByteArray(1, char(0x88)) + Literal("content-type", "application/grpc");
+        auto trailers = Literal("grpc-status", response.status);
+        if (!response.statusMessage.isEmpty())
+            trailers += Literal("grpc-message", response.statusMessage);
+
+        if (response.trailersOnly)
+        {
+            socket->write(Frame(HEADERS, END_HEADERS | END_STREAM, stream, headers + trailers));
+            return;
+        }
+
+        socket->write(Frame(HEADERS, END_HEADERS, stream, headers));
+        socket->write(Frame(DATA, 0, stream, StatsServiceClient::FrameMessage(response.message)));
+        socket->write(Frame(HEADERS, END_HEADERS | END_STREAM, stream, trailers));
+    }
+
+  private:
+    QHash<QTcpSocket *, Connection> connections;
+};
+
+class StatsServiceClientTest : public QObject
+{
+    Q_OBJECT
+  public:
+    StatsServiceClientTest(QObject *parent = nullptr) : QObject(parent){};
+
+  private slots:
+    void testFraming()
+    {
+        const QByteArray message = "\x0a\x03" "abc";
+        const auto framed = StatsServiceClient::FrameMessage(message);
+        QCOMPARE(framed, QByteArray::fromHex("0000000005") + message);
+        const auto unframed = StatsServiceClient::UnframeMessage(framed);
+        QVERIFY(unframed);
+        QCOMPARE(*unframed, message);
+
+        // An empty message is still framed.
+        QCOMPARE(StatsServiceClient::FrameMessage({}), QByteArray::fromHex("0000000000"));
+        const auto empty = StatsServiceClient::UnframeMessage(QByteArray::fromHex("0000000000"));
+        QVERIFY(empty);
+        QVERIFY(empty->isEmpty());
+
+        // Truncated, compressed and too short bodies are rejected.
+        QVERIFY(!StatsServiceClient::UnframeMessage(framed.chopped(1)));
+        QVERIFY(!StatsServiceClient::UnframeMessage(QByteArray::fromHex("01") + framed.mid(1)));
+        QVERIFY(!StatsServiceClient::UnframeMessage(QByteArray::fromHex("00000000")));
+    }
+
+    void testEncodeQueryStatsRequest()
+    {
+        QCOMPARE(StatsServiceClient::EncodeQueryStatsRequest({}, false), QByteArray{});
+        QCOMPARE(StatsServiceClient::EncodeQueryStatsRequest(u"abc"_qs, true), QByteArray::fromHex("0a036162631001"));
+        QCOMPARE(StatsServiceClient::EncodeQueryStatsRequest({}, true), QByteArray::fromHex("1001"));
+    }
+
+    void testDecodeQueryStatsResponse()
+    {
+        // Unknown fields of every wire type are skipped.
+        const auto message = BytesField(1, StatMessage("outbound>>>proxy>>>traffic>>>uplink", 300) + VarintField(7, 1)) + //
+                             VarintField(5, 42) +                                                                        //
+                             BytesField(1, StatMessage("inbound>>>socks>>>traffic>>>downlink", 1ULL << 40));
+        const auto stats = StatsServiceClient::DecodeQueryStatsResponse(message);
+        QVERIFY(stats);
+        QCOMPARE(stats->size(), 2);
+        QCOMPARE(stats->at(0), (std::pair{ u"outbound>>>proxy>>>traffic>>>uplink"_qs, qint64(300) }));
+        QCOMPARE(stats->at(1), (std::pair{ u"inbound>>>socks>>>traffic>>>downlink"_qs, qint64(1LL << 40) }));
+
+        QVERIFY(StatsServiceClient::DecodeQueryStatsResponse({})->isEmpty());
+        QVERIFY(!StatsServiceClient::DecodeQueryStatsResponse(message.chopped(1)));
+        // A length beyond the message, and a varint which never ends.
+        QVERIFY(!StatsServiceClient::DecodeQueryStatsResponse(QByteArray::fromHex("0a05")));
+        QVERIFY(!StatsServiceClient::DecodeQueryStatsResponse(QByteArray::fromHex("08ffffffffffffffffffff01")));
+    }
+
+    void testDecodeSysStatsResponse()
+    {
+        const auto message = VarintField(1, 12) + VarintField(2, 3) + VarintField(3, 4096) + VarintField(5, 8192) + BytesField(11, "ignored") + VarintField(10, 60);
+        const auto stats = StatsServiceClient::DecodeSysStatsResponse(message);
+        QVERIFY(stats);
+        QCOMPARE(stats->numGoroutine, 12u);
+        QCOMPARE(stats->numGC, 3u);
+        QCOMPARE(stats->alloc, 4096ULL);
+        QCOMPARE(stats->sys, 8192ULL);
+        QCOMPARE(stats->uptime, 60u);
+        QCOMPARE(stats->frees, 0ULL);
+        QVERIFY(!StatsServiceClient::DecodeSysStatsResponse(QByteArray::fromHex("08")));
+    }
+
+    void testQueryStats()
+    {
+        GrpcStubServer server;
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        server.response.message = BytesField(1, StatMessage("outbound>>>proxy>>>traffic>>>downlink", 1234));
+
+        StatsServiceClient client{ u"127.0.0.1"_qs, server.serverPort() };
+        std::optional<StatsServiceClient::StatList> received;
+        QString error;
+        connect(&client, &StatsServiceClient::OnStatsReceived, this, [&](const StatsServiceClient::StatList &stats) { received = stats; });
+        connect(&client, &StatsServiceClient::OnError, this, [&](const QString &, const QString &e) { error = e; });
+
+        client.QueryStats(u"traffic"_qs, true);
+        QTRY_VERIFY_WITH_TIMEOUT(received || !error.isEmpty(), 5000);
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+        QCOMPARE(*received, (StatsServiceClient::StatList{ { u"outbound>>>proxy>>>traffic>>>downlink"_qs, 1234 } }));
+        QCOMPARE(server.requests, QList<QByteArray>{ StatsServiceClient::FrameMessage(StatsServiceClient::EncodeQueryStatsRequest(u"traffic"_qs, true)) });
+    }
+
+    void testGetSysStats()
+    {
+        GrpcStubServer server;
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        server.response.message = VarintField(1, 7) + VarintField(10, 3600);
+
+        StatsServiceClient client{ u"127.0.0.1"_qs, server.serverPort() };
+        std::optional<StatsServiceClient::SysStats> received;
+        QString error;
+        connect(&client, &StatsServiceClient::OnSysStatsReceived, this, [&](const StatsServiceClient::SysStats &stats) { received = stats; });
+        connect(&client, &StatsServiceClient::OnError, this, [&](const QString &, const QString &e) { error = e; });
+
+        client.GetSysStats();
+        QTRY_VERIFY_WITH_TIMEOUT(received || !error.isEmpty(), 5000);
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+        QCOMPARE(received->numGoroutine, 7u);
+        QCOMPARE(received->uptime, 3600u);
+        QCOMPARE(server.requests, QList<QByteArray>{ StatsServiceClient::FrameMessage({}) });
+    }
+
+    void testErrorStatus_data()
+    {
+        QTest::addColumn<bool>("trailersOnly");
+        QTest::newRow("trailers") << false;
+        QTest::newRow("trailers-only") << true;
+    }
+
+    void testErrorStatus()
+    {
+        QFETCH(bool, trailersOnly);
+
+        GrpcStubServer server;
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        server.response.status = "12";
+        server.response.statusMessage = "unknown%20service";
+        server.response.trailersOnly = trailersOnly;
+
+        StatsServiceClient client{ u"127.0.0.1"_qs, server.serverPort() };
+        bool received = false;
+        QString method, error;
+        connect(&client, &StatsServiceClient::OnStatsReceived, this, [&]() { received = true; });
+        connect(&client, &StatsServiceClient::OnError, this, [&](const QString &m, const QString &e) { method = m, error = e; });
+
+        client.QueryStats({}, false);
+        QTRY_VERIFY_WITH_TIMEOUT(received || !error.isEmpty(), 5000);
+        QVERIFY(!received);
+        QCOMPARE(method, u"QueryStats"_qs);
+        QCOMPARE(error, u"gRPC status 12 unknown service"_qs);
+    }
+
+    void testUnreachable()
+    {
+        // Find a port nobody listens on.
+        quint16 port;
+        {
+            QTcpServer server;
+            QVERIFY(server.listen(QHostAddress::LocalHost));
+            port = server.serverPort();
+        }
+
+        StatsServiceClient client{ u"127.0.0.1"_qs, port };
+        QString method, error;
+        connect(&client, &StatsServiceClient::OnError, this, [&](const QString &m, const QString &e) { method = m, error = e; });
+
+        client.GetSysStats();
+        QTRY_VERIFY_WITH_TIMEOUT(!error.isEmpty(), 10000);
+        QCOMPARE(method, u"GetSysStats"_qs);
+    }
+};
+
+QTEST_MAIN(StatsServiceClientTest)
+#include "tst_StatsServiceClient.moc"
@@ -0,0 +1,161 @@
+//  Qv2rayBase, the modular feature-rich infrastructure library for Qv2ray.
+//  Copyright (C) 2021 Moody and relavent Qv2ray contributors.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Qv2rayBase/private/Profile/TrafficHistory_p.hpp"
+
+#include <QtTest>
+#include <cmath>
+
+using namespace Qv2rayBase::Profile;
+
+// Some time well after the epoch, aligned to an hour.
+constexpr qint64 BASE_TIME = 1600000000LL * 1000 - (1600000000LL % 3600) * 1000;
+
+class TrafficHistoryTest : public QObject
+{
+    Q_OBJECT
+  public:
+    TrafficHistoryTest(QObject *parent = nullptr) : QObject(parent){};
+
+  private:
+    static StatisticsObject MakeStats(quint64 proxyUp, quint64 proxyDown, quint64 directUp = 0, quint64 directDown = 0)
+    {
+        StatisticsObject s;
+        s.proxyUp = proxyUp;
+        s.proxyDown = proxyDown;
+        s.directUp = directUp;
+        s.directDown = directDown;
+        return s;
+    }
+
+    static void CompareStats(const StatisticsObject &actual, const StatisticsObject &expected)
+    {
+        QCOMPARE(actual.proxyUp, expected.proxyUp);
+        QCOMPARE(actual.proxyDown, expected.proxyDown);
+        QCOMPARE(actual.directUp, expected.directUp);
+        QCOMPARE(actual.directDown, expected.directDown);
+    }
+
+  private slots:
+    void testEmpty()
+    {
+        TrafficHistory history;
+        const auto seconds = history.History(TrafficHistoryResolution::PerSecond, BASE_TIME);
+        QCOMPARE(seconds.size(), 120);
+        for (const auto &s : seconds)
+            CompareStats(s, {});
+        CompareStats(history.Rate(BASE_TIME), {});
+    }
+
+    void testBuckets()
+    {
+        TrafficHistory history;
+        history.Append(MakeStats(100, 200), BASE_TIME);
+        history.Append(MakeStats(10, 20), BASE_TIME + 500);
+        history.Append(MakeStats(1, 2, 3, 4), BASE_TIME + 1000);
+        history.Append(MakeStats(1000, 0), BASE_TIME + 60 * 1000);
+
+        // The newest bucket is the last one.
+        const auto seconds = history.History(TrafficHistoryResolution::PerSecond, BASE_TIME + 60 * 1000);
+        QCOMPARE(seconds.size(), 120);
+        CompareStats(seconds.at(119), MakeStats(1000, 0));
+        CompareStats(seconds.at(119 - 59), MakeStats(1, 2, 3, 4));
+        CompareStats(seconds.at(119 - 60), MakeStats(110, 220));
+        CompareStats(seconds.at(119 - 30), {});
+
+        const auto minutes = history.History(TrafficHistoryResolution::PerMinute, BASE_TIME + 60 * 1000);
+        CompareStats(minutes.at(119), MakeStats(1000, 0));
+        CompareStats(minutes.at(118), MakeStats(111, 222, 3, 4));
+
+        const auto hours = history.History(TrafficHistoryResolution::PerHour, BASE_TIME + 60 * 1000);
+        QCOMPARE(hours.size(), 168);
+        CompareStats(hours.at(167), MakeStats(1111, 222, 3, 4));
+    }
+
+    void testBucketsExpire()
+    {
+        TrafficHistory history;
+        history.Append(MakeStats(100, 0), BASE_TIME);
+
+        // 120 seconds later the slot is reused, the stale bucket must not show up.
+        history.Append(MakeStats(5, 0), BASE_TIME + 120 * 1000);
+        const auto seconds = history.History(TrafficHistoryResolution::PerSecond, BASE_TIME + 120 * 1000);
+        CompareStats(seconds.at(119), MakeStats(5, 0));
+        CompareStats(seconds.at(0), {});
+
+        // Asking for a time far after the last sample gives nothing.
+        for (const auto &s : history.History(TrafficHistoryResolution::PerSecond, BASE_TIME + 3600 * 1000))
+            CompareStats(s, {});
+    }
+
+    void testRate()
+    {
+        TrafficHistory history;
+        qint64 time = BASE_TIME;
+        for (auto i = 0; i < 100; i++, time += 1000)
+            history.Append(MakeStats(1000, 4000), time);
+        time -= 1000;
+
+        // A steady throughput converges to itself.
+        const auto rate = history.Rate(time);
+        QVERIFY(std::abs(static_cast<qint64>(rate.proxyUp) - 1000) <= 1);
+        QVERIFY(std::abs(static_cast<qint64>(rate.proxyDown) - 4000) <= 1);
+        QVERIFY(rate.directUp == 0);
+
+        // Without new samples, the rate decays by e after one time constant (plus the one second of grace).
+        const auto idle = history.Rate(time + 6000);
+        QVERIFY(std::abs(static_cast<qint64>(idle.proxyDown) - std::llround(4000 / std::exp(1.0))) <= 2);
+    }
+
+    void testFirstSample()
+    {
+        TrafficHistory history;
+        history.Append(MakeStats(1000, 0), BASE_TIME);
+        // The first sample counts as one second of traffic, weighted by 1 - e^(-1/5).
+        QCOMPARE(static_cast<qint64>(history.Rate(BASE_TIME).proxyUp), std::llround(1000 * (1 - std::exp(-0.2))));
+    }
+
+    void testSerialize()
+    {
+        TrafficHistory history;
+        qint64 time = BASE_TIME;
+        for (auto i = 0; i < 200; i++, time += 7000)
+            history.Append(MakeStats(i, i * 2, i * 3, i * 4), time);
+
+        const auto restored = TrafficHistory::Deserialize(history.Serialize());
+        for (const auto resolution : { TrafficHistoryResolution::PerSecond, TrafficHistoryResolution::PerMinute, TrafficHistoryResolution::PerHour })
+        {
+            const auto expected = history.History(resolution, time);
+            const auto actual = restored.History(resolution, time);
+            QCOMPARE(actual.size(), expected.size());
+            for (auto i = 0; i < expected.size(); i++)
+                CompareStats(actual.at(i), expected.at(i));
+        }
+        CompareStats(restored.Rate(time), history.Rate(time));
+        QCOMPARE(restored.Serialize(), history.Serialize());
+    }
+
+    void testDeserializeInvalid()
+    {
+        const auto restored = TrafficHistory::Deserialize("not a history");
+        CompareStats(restored.Rate(BASE_TIME), {});
+        for (const auto &s : restored.History(TrafficHistoryResolution::PerMinute, BASE_TIME))
+            CompareStats(s, {});
+    }
+};
+
+QTEST_MAIN(TrafficHistoryTest)
+#include "tst_TrafficHistory.moc"